@@ -0,0 +1,123 @@
+/**
+async_writer.h
+Purpose: Asynchronous output for the gen_tsp executables: result and timing lines are formatted by the producing
+    thread and pushed on a lock-free multi-producer single-consumer queue; a background writer thread takes the
+    whole queue at once and writes it with one fwrite per file, so no file I/O happens inside the measured phases
+
+@author Danilo Franco
+*/
+
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+#include <atomic>
+#include <thread>
+#include <mutex>        // once_flag
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdarg>      // va_list
+
+#define WRITERLINE 256          // characters of a queued line (longer ones are truncated)
+#define WRITERSLEEP 1000        // microseconds the writer sleeps when the queue is empty
+
+/**
+Queued line: destination file and formatted text
+*/
+struct WriterRecord {
+    WriterRecord *next;
+    FILE *file;
+    int len;
+    char text[WRITERLINE];
+};
+
+atomic<WriterRecord*> writerQueue(NULL);    // lock-free stack of the pushed lines (newest first)
+atomic<bool> writerStop(false);
+thread writerThread;
+once_flag writerStarted;
+
+/**
+Writes a batch of lines (taken from the queue, newest first) with a single fwrite per destination file
+
+@param  records: Newest record of the batch
+*/
+void writeBatch(WriterRecord *records){
+    WriterRecord *prev,*next;
+    vector<pair<FILE*, string> > buffers;
+    size_t k;
+
+    // back to push order
+    prev = NULL;
+    while (records != NULL){
+        next = records->next;
+        records->next = prev;
+        prev = records;
+        records = next;
+    }
+    for (records=prev; records!=NULL; records=next){
+        for (k=0; k<buffers.size() && buffers[k].first!=records->file; ++k);
+        if (k == buffers.size())
+            buffers.push_back(make_pair(records->file, string()));
+        buffers[k].second.append(records->text, records->len);
+        next = records->next;
+        delete records;
+    }
+    for (k=0; k<buffers.size(); ++k)
+        fwrite(buffers[k].second.data(), 1, buffers[k].second.size(), buffers[k].first);
+}
+
+/**
+Body of the writer thread: drains the queue until stopAsyncWriter is called and the queue is empty
+*/
+void writerLoop(){
+    WriterRecord *records;
+    bool stopping;
+    while (true){
+        stopping = writerStop.load(memory_order_acquire);
+        records = writerQueue.exchange(NULL, memory_order_acquire);
+        if (records != NULL)
+            writeBatch(records);
+        else if (stopping)
+            return;
+        else
+            this_thread::sleep_for(chrono::microseconds(WRITERSLEEP));
+    }
+}
+
+/**
+Queues a formatted line for a file (printf-like); the writer thread is started by the first call
+
+@param  file: Destination stream
+@param  format: printf format
+*/
+void asyncPrintf(FILE *file, const char *format, ...){
+    WriterRecord *record;
+    va_list args;
+
+    call_once(writerStarted, [](){ writerThread = thread(writerLoop); });
+
+    record = new WriterRecord;
+    record->file = file;
+    va_start(args, format);
+    record->len = vsnprintf(record->text, WRITERLINE, format, args);
+    va_end(args);
+    if (record->len < 0)
+        record->len = 0;
+    if (record->len >= WRITERLINE)
+        record->len = WRITERLINE-1;
+
+    record->next = writerQueue.load(memory_order_relaxed);
+    while (!writerQueue.compare_exchange_weak(record->next, record, memory_order_release, memory_order_relaxed));
+}
+
+/**
+Writes every queued line and stops the writer thread (must be called before closing the files)
+*/
+void stopAsyncWriter(){
+    writerStop.store(true, memory_order_release);
+    if (writerThread.joinable())
+        writerThread.join();
+}
+
+#endif
@@ -0,0 +1,234 @@
+/**
+autotune.cpp
+Purpose: Parameter autotuner of the genetic algorithm by successive halving: every configuration (population, top,
+    mutation probability) runs genetic_tsp on the instances of a class synthesised as in generator.cpp with a short
+    time limit and is scored by its time to reach a target cost; the best 1/eta of the configurations survive to the
+    next rung, whose time limit is eta times longer, until a single configuration would be left
+
+usage: tune numNodes [--mode random|euclid|cluster|grid|road] [--instances k] [--seed s] [--threads t]
+            [--pops p1,p2,..] [--tops t1,t2,..] [--mutations m1,m2,..] [--budget s] [--eta e] [--gap g]
+            [--early-stop rounds param]
+
+    --pops: populations (default: Compute_Pop_Size for winning probabilities 0.01, 0.1 and 0.5)
+    --tops, --mutations: selection percentages (default 0.3,0.4,0.5) and mutation probabilities (default 0.1,0.5)
+    --budget: time limit of each run in the first rung, seconds (default 1)
+    --gap: target cost of each instance, in percent above its Held-Karp lower bound; without it the target is the
+           best cost reached by any configuration in the first rung
+    score of a run: seconds to the target, or its time limit times cost/target if the target has not been reached;
+    the score of a configuration is the average over the instances. Every configuration sees the same random
+    streams on a given instance (the generator is seeded again before each run)
+
+@author Danilo Franco
+*/
+
+#include <ctime>
+#include <chrono>
+#include <vector>
+#include <climits>      // INT_MAX
+#include <algorithm>
+
+#include "in_out.h"
+#include "memory_utils.h"
+#include "generator_utils.h"
+#include "sizing_utils.h"
+#include "other_funcs.h"
+
+#define TUNEETA 3               // survivors of a rung: one configuration out of TUNEETA
+#define TUNEINSTANCES 3
+#define TUNEBUDGET 1.0          // seconds
+#define TUNEEARLYROUNDS 9       // early stop settings of the launch scripts
+#define TUNEEARLYPARAM 1
+
+/**
+Configuration under test and its score in the latest rung
+*/
+struct TuneConfig {
+    int population;
+    double top;
+    double mutatProb;
+    double score;
+    int reached;
+    double cost;
+};
+
+/**
+Parses a comma separated list of numbers
+
+@param  val: Option value (NULL: the default list is kept)
+@param  list: Written with the numbers
+
+@return     False if the list is empty or has a non-positive number
+*/
+bool parseList(const char *val, vector<double> &list){
+    char *end;
+    if (val == NULL)
+        return true;
+    list.clear();
+    while (*val){
+        list.push_back(strtod(val, &end));
+        if (end==val || list.back()<=0 || (*end!=',' && *end!='\0'))
+            return false;
+        val = *end==',' ? end+1 : end;
+    }
+    return !list.empty();
+}
+
+/**
+Runs every configuration on every instance with the time limit of the rung and sets its score
+
+@param  configs: Configurations of the rung
+@param  instances: Cost matrices of the instances
+@param  targets: Target cost of each instance (-1: unknown, written with the best cost reached in this rung)
+@param  numNodes: Number of travelling-nodes in the problem
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+@param  budget: Time limit of each run, seconds
+@param  earlyStopRounds, earlyStopParam: Early stop settings of genetic_tsp
+@param  seed: Seed of the random streams (instance index added)
+*/
+void runRung(vector<TuneConfig> &configs, const vector<int*> &instances, vector<long long> &targets, int numNodes, int numThreads, double budget, int earlyStopRounds, double earlyStopParam, unsigned long long seed){
+    vector<vector<long long> > costs(configs.size(), vector<long long>(instances.size()));
+    vector<vector<double> > times(configs.size(), vector<double>(instances.size()));
+    int *solution;
+    size_t c,k;
+    chrono::high_resolution_clock::time_point t_start;
+    chrono::duration<double> exec_time;
+
+    timeLimit = budget;
+    for (k=0; k<instances.size(); ++k){
+        targetCost = targets[k];
+        for (c=0; c<configs.size(); ++c){
+            srand(seed+k);
+            seedRandom(seed+k);
+            t_start = chrono::high_resolution_clock::now();
+            solution = genetic_tsp(0, 1, numThreads, instances[k], numNodes, configs[c].population, configs[c].top, INT_MAX,
+                                   configs[c].mutatProb, earlyStopRounds, earlyStopParam);
+            exec_time = chrono::high_resolution_clock::now()-t_start;
+            costs[c][k] = solution[numNodes];
+            times[c][k] = exec_time.count();
+            delete[] solution;
+        }
+        if (targets[k] < 0)
+            for (c=0; c<configs.size(); ++c)
+                targets[k] = c==0 ? costs[c][k] : min(targets[k], costs[c][k]);
+    }
+
+    for (c=0; c<configs.size(); ++c){
+        configs[c].score = 0;
+        configs[c].reached = 0;
+        configs[c].cost = 0;
+        for (k=0; k<instances.size(); ++k){
+            if (costs[c][k] <= targets[k]){
+                configs[c].score += min(times[c][k], budget);
+                ++configs[c].reached;
+            }
+            else
+                configs[c].score += budget*costs[c][k]/max(targets[k], 1LL);
+            configs[c].cost += costs[c][k];
+        }
+        configs[c].score /= instances.size();
+        configs[c].cost /= instances.size();
+    }
+}
+
+int main(int argc, char* argv[]){
+    if (argc<2){
+        cerr << "need 1 args: nodes number\n";
+        return 1;
+    }
+
+    int numNodes,numThreads,mode,numInstances,earlyStopRounds,rung,survivors,k;
+    unsigned long long seed;
+    double budget,eta,gap,earlyStopParam;
+    bool fixedTarget;
+    const char *val;
+    vector<double> pops, tops, mutations;
+    vector<TuneConfig> configs;
+    vector<int*> instances;
+    vector<long long> targets;
+
+    numNodes = atoi(argv[1]);
+    val = getOption(argc, argv, 2, "--seed");
+    seed = val!=NULL ? strtoull(val, NULL, 10) : time(NULL);
+    val = getOption(argc, argv, 2, "--threads");
+    numThreads = val!=NULL ? atoi(val) : 1;
+    val = getOption(argc, argv, 2, "--mode");
+    mode = val!=NULL ? genMode(val) : GEN_RANDOM;
+    val = getOption(argc, argv, 2, "--instances");
+    numInstances = val!=NULL ? atoi(val) : TUNEINSTANCES;
+    val = getOption(argc, argv, 2, "--budget");
+    budget = val!=NULL ? atof(val) : TUNEBUDGET;
+    val = getOption(argc, argv, 2, "--eta");
+    eta = val!=NULL ? atof(val) : TUNEETA;
+    val = getOption(argc, argv, 2, "--gap");
+    fixedTarget = val!=NULL;
+    gap = fixedTarget ? atof(val) : 0;
+    earlyStopRounds = TUNEEARLYROUNDS;
+    earlyStopParam = TUNEEARLYPARAM;
+    for (int i=2; i<argc-2; ++i)
+        if (strcmp(argv[i], "--early-stop")==0){
+            earlyStopRounds = atoi(argv[i+1]);
+            earlyStopParam = atof(argv[i+2]);
+        }
+
+    pops.push_back(populationForProbability(numNodes, 0.01));
+    pops.push_back(populationForProbability(numNodes, 0.1));
+    pops.push_back(populationForProbability(numNodes, 0.5));
+    tops.push_back(0.3);
+    tops.push_back(0.4);
+    tops.push_back(0.5);
+    mutations.push_back(0.1);
+    mutations.push_back(0.5);
+
+    if (numNodes<=1 || numThreads<1 || mode<0 || numInstances<1 || budget<=0 || eta<=1 || gap<0 ||
+        earlyStopRounds<=0 || earlyStopParam<0 ||
+        !parseList(getOption(argc, argv, 2, "--pops"), pops) ||
+        !parseList(getOption(argc, argv, 2, "--tops"), tops) ||
+        !parseList(getOption(argc, argv, 2, "--mutations"), mutations)){
+        cerr <<"Invalid arguments!"<< endl;
+        return 1;
+    }
+    // printed so that every tuning can be repeated
+    cerr << "seed " << seed << endl;
+
+    for (double p : pops)
+        for (double t : tops)
+            for (double m : mutations){
+                TuneConfig config = {max((int)p, AVGELEMS), t, min(m, 1.0), 0, 0, 0};
+                if (t<1 && (int)(config.population*t)<config.population)
+                    configs.push_back(config);
+            }
+    if (configs.empty()){
+        cerr <<"Invalid arguments!"<< endl;
+        return 1;
+    }
+
+    for (k=0; k<numInstances; ++k){
+        instances.push_back(allocLarge<int>((size_t)numNodes*numNodes));
+        genInstance(mode, instances[k], numNodes, seed+k, numThreads);
+        targets.push_back(fixedTarget ? heldKarpBound(instances[k], numNodes, numThreads)*(1+gap/100) : -1);
+    }
+
+    // SUCCESSIVE HALVING
+    for (rung=0; ; ++rung){
+        runRung(configs, instances, targets, numNodes, numThreads, budget, earlyStopRounds, earlyStopParam, seed);
+        stable_sort(configs.begin(), configs.end(), [](const TuneConfig &a, const TuneConfig &b){
+            return a.score < b.score;
+        });
+        printf("rung %d: %d configurations, %.3f s per run\n", rung, (int)configs.size(), budget);
+        for (const TuneConfig &c : configs)
+            printf("\tpopulation %d top %.2f mutation %.2f: score %.3f s, target reached %d/%d, average cost %.0f\n",
+                   c.population, c.top, c.mutatProb, c.score, c.reached, numInstances, c.cost);
+        survivors = max(1, (int)(configs.size()/eta));
+        configs.resize(survivors);
+        if (survivors == 1)
+            break;
+        budget *= eta;
+    }
+
+    printf("best: population %d top %.2f mutation %.2f (time to target %.3f s, reached on %d/%d instances)\n",
+           configs[0].population, configs[0].top, configs[0].mutatProb, configs[0].score, configs[0].reached, numInstances);
+
+    for (k=0; k<numInstances; ++k)
+        freeLarge(instances[k], (size_t)numNodes*numNodes);
+    return 0;
+}
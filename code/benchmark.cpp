@@ -0,0 +1,238 @@
+/**
+benchmark.cpp
+Purpose: Microbenchmarks of the genetic kernels on synthetic instances
+
+usage: bench [numNodes] [population] [repetitions]
+
+    eval: fitness evaluation, one tour at a time (original loop) against the interleaved evaluator of
+          evaluation_utils.h (EVALLANES tours in lockstep + prefetch); single thread, milliseconds per generation
+    rank: sorting of the generation costs, full sort against sorting the children only and merging them with the
+          already sorted parents (sort_vector); single thread, milliseconds per generation
+    cross: crossover children per second, original set-based fill against the bitmap + compaction kernels of
+           simd_utils.h (scalar, AVX2, AVX-512 where supported); single thread, no mutation
+    rand: bounded random integers per second, rand()%bound against the bulk generator of rng_utils.h
+
+@author Danilo Franco
+*/
+
+#include <chrono>
+#include <algorithm>
+
+#include "in_out.h"
+#include "memory_utils.h"
+#include "generator_utils.h"
+#include "genetic_utils.h"
+#include "other_funcs.h"
+
+/**
+Original evaluation loop: one tour at a time, each matrix load waiting for the previous index load
+
+@param  pop: Population to be evaluated
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+*/
+void evaluate_single(Population *pop, const int *cost_matrix){
+    int i,j,source,destination,numNodes,*tour;
+    unsigned long long h;
+    numNodes = pop->numNodes;
+    for (i=0; i<pop->size; ++i){
+        tour = row(pop, i);
+        source = tour[numNodes-1];
+        destination = tour[0];
+        pop->cost[i] = cost_matrix[(size_t)source*numNodes+destination];
+        h = edgeHash(source, destination);
+        for (j=0; j<numNodes-1; ++j){
+            source = destination;
+            destination = tour[j+1];
+            pop->cost[i] += cost_matrix[(size_t)source*numNodes+destination];
+            h += edgeHash(source, destination);
+        }
+        pop->hash[i] = h;
+    }
+}
+
+/**
+Times the two evaluators on random tours and checks that they agree
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  population: Number of tours
+@param  reps: Number of timed repetitions
+*/
+void bench_eval(const int *cost_matrix, int numNodes, int population, int reps){
+    Population *pop;
+    int i,r,*expected;
+    chrono::high_resolution_clock::time_point t_start;
+    chrono::duration<double> single,lanes;
+
+    pop = newPopulation(population, numNodes);
+    for (i=0; i<population; ++i){
+        for (int j=0; j<numNodes; ++j)
+            row(pop, i)[j] = j;
+        random_shuffle(row(pop, i), row(pop, i)+numNodes, myRand);
+    }
+    expected = new int[population];
+
+    evaluate_single(pop, cost_matrix);
+    copy(pop->cost, pop->cost+population, expected);
+    t_start = chrono::high_resolution_clock::now();
+    for (r=0; r<reps; ++r)
+        evaluate_single(pop, cost_matrix);
+    single = chrono::high_resolution_clock::now()-t_start;
+
+    evaluate_rows(pop, cost_matrix, 0, population, 1);
+    if (!equal(pop->cost, pop->cost+population, expected))
+        cerr << "eval: interleaved costs differ!" << endl;
+    t_start = chrono::high_resolution_clock::now();
+    for (r=0; r<reps; ++r)
+        evaluate_rows(pop, cost_matrix, 0, population, 1);
+    lanes = chrono::high_resolution_clock::now()-t_start;
+
+    printf("eval %d nodes %d tours: single %.3f ms, interleaved(%d) %.3f ms, speedup %.2f\n", numNodes, population,
+           single.count()*1000/reps, EVALLANES, lanes.count()*1000/reps, single.count()/lanes.count());
+
+    delete[] expected;
+    deletePopulation(pop);
+}
+
+/**
+Times the full and the incremental sort of a generation whose first bestNum costs are already sorted
+
+@param  population: Number of costs
+@param  bestNum: Number of sorted leading costs (parents)
+@param  reps: Number of timed repetitions
+*/
+void bench_rank(int population, int bestNum, int reps){
+    int i,r,*cost,*rank,*work;
+    chrono::duration<double> full,incremental;
+    chrono::high_resolution_clock::time_point t_start;
+
+    cost = new int[population];
+    rank = new int[population];
+    work = new int[population];
+    for (i=0; i<population; ++i)
+        cost[i] = rand()%1000000;
+    sort(cost, cost+bestNum);
+
+    full = chrono::duration<double>::zero();
+    incremental = chrono::duration<double>::zero();
+    for (r=0; r<reps; ++r){
+        copy(cost, cost+population, work);
+        for (i=0; i<population; ++i)
+            rank[i] = i;
+        t_start = chrono::high_resolution_clock::now();
+        sort_vector(rank, work, population, 0, 1);
+        full += chrono::high_resolution_clock::now()-t_start;
+
+        copy(cost, cost+population, work);
+        for (i=0; i<population; ++i)
+            rank[i] = i;
+        t_start = chrono::high_resolution_clock::now();
+        sort_vector(rank, work, population, bestNum, 1);
+        incremental += chrono::high_resolution_clock::now()-t_start;
+        if (!is_sorted(work, work+population))
+            cerr << "rank: incremental sort failed!" << endl;
+    }
+
+    printf("rank %d costs %d sorted: full %.3f ms, incremental %.3f ms, speedup %.2f\n", population, bestNum,
+           full.count()*1000/reps, incremental.count()*1000/reps, full.count()/incremental.count());
+
+    delete[] cost;
+    delete[] rank;
+    delete[] work;
+}
+
+/**
+Times the crossover (children per second) with the original set-based fill and with each compaction kernel
+
+@param  numNodes: Number of travelling-nodes in the problem
+@param  reps: Number of children generated by each version
+*/
+void bench_crossover(int numNodes, int reps){
+    const char *names[] = {"scalar", "avx2", "avx512"};
+    int r,level,saved,*parents,*expected,*son;
+    chrono::duration<double> exec_time;
+    chrono::high_resolution_clock::time_point t_start;
+
+    parents = new int[numNodes*2];
+    expected = new int[numNodes];
+    son = new int[numNodes];
+    for (r=0; r<numNodes; ++r)
+        parents[r] = parents[numNodes+r] = r;
+    random_shuffle(parents, parents+numNodes, myRand);
+    random_shuffle(parents+numNodes, parents+numNodes*2, myRand);
+
+    t_start = chrono::high_resolution_clock::now();
+    for (r=0; r<reps; ++r)
+        crossover_firstHalf_withMutation_set(parents, parents+numNodes, expected, numNodes, 0);
+    exec_time = chrono::high_resolution_clock::now()-t_start;
+    printf("cross %d nodes: set %.0f children/s", numNodes, reps/exec_time.count());
+
+    saved = simdLevel;
+    for (level=SIMD_SCALAR; level<=saved; ++level){
+        simdLevel = level;
+        t_start = chrono::high_resolution_clock::now();
+        for (r=0; r<reps; ++r)
+            crossover_firstHalf_withMutation(parents, parents+numNodes, son, numNodes, 0);
+        exec_time = chrono::high_resolution_clock::now()-t_start;
+        printf(", %s %.0f children/s", names[level], reps/exec_time.count());
+        if (!equal(son, son+numNodes, expected))
+            printf(" (WRONG)");
+    }
+    simdLevel = saved;
+    printf("\n");
+
+    delete[] parents;
+    delete[] expected;
+    delete[] son;
+}
+
+/**
+Times the draw of bounded random integers with rand() and with the bulk generator
+
+@param  bound: Number of possible values
+@param  reps: Number of draws
+*/
+void bench_random(int bound, int reps){
+    int r;
+    unsigned sum;
+    chrono::duration<double> libc,bulk;
+    chrono::high_resolution_clock::time_point t_start;
+
+    sum = 0;
+    t_start = chrono::high_resolution_clock::now();
+    for (r=0; r<reps; ++r)
+        sum += rand()%bound;
+    libc = chrono::high_resolution_clock::now()-t_start;
+    t_start = chrono::high_resolution_clock::now();
+    for (r=0; r<reps; ++r)
+        sum += randomBelow(bound);
+    bulk = chrono::high_resolution_clock::now()-t_start;
+
+    printf("rand bound %d: rand() %.1f M/s, bulk %.1f M/s (checksum %u)\n", bound, reps/libc.count()/1e6,
+           reps/bulk.count()/1e6, sum);
+}
+
+int main(int argc, char *argv[]){
+    int numNodes,population,reps,*cost_matrix;
+
+    numNodes = argc>1 ? atoi(argv[1]) : 5000;
+    population = argc>2 ? atoi(argv[2]) : 200;
+    reps = argc>3 ? atoi(argv[3]) : 10;
+    if (numNodes<=1 || population<1 || reps<1){
+        cerr <<"Invalid arguments!"<< endl;
+        return 1;
+    }
+    srand(1);
+    seedRandom(1);
+
+    cost_matrix = allocLarge<int>((size_t)numNodes*numNodes);
+    genInstance(GEN_RANDOM, cost_matrix, numNodes, 1, 1);
+
+    bench_eval(cost_matrix, numNodes, population, reps);
+    bench_rank(population, population*3/10, reps);
+    bench_crossover(numNodes, population*reps);
+    bench_random(population, 10000000);
+
+    freeLarge(cost_matrix, (size_t)numNodes*numNodes);
+    return 0;
+}
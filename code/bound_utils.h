@@ -0,0 +1,192 @@
+/**
+bound_utils.h
+Purpose: Held-Karp lower bound of the tour cost (1-trees with subgradient optimisation of the node penalties), used by
+    genetic_engine.h to stop as soon as the best tour is within a given gap from the optimum
+
+@author Danilo Franco
+*/
+
+#ifndef BOUND_UTILS_H
+#define BOUND_UTILS_H
+
+#include <vector>
+#include <cmath>
+#include <cfloat>       // DBL_MAX
+#include <omp.h>
+
+#define BOUNDITERATIONS 200     // maximum subgradient iterations
+#define BOUNDPATIENCE 10        // iterations without improvement after which the step factor is halved
+#define BOUNDPARALLEL 1000      // minimum number of nodes for the parallel minimum spanning tree
+
+/**
+Cost of the nearest neighbour tour from node 0 (upper bound for the subgradient step)
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+*/
+long long nearestNeighbourCost(const int *cost_matrix, int numNodes){
+    vector<bool> visited(numNodes, false);
+    long long total = 0;
+    int current,next,i,j;
+    current = 0;
+    visited[0] = true;
+    for (i=1; i<numNodes; ++i){
+        next = -1;
+        for (j=0; j<numNodes; ++j)
+            if (!visited[j] && (next<0 || cost_matrix[(size_t)current*numNodes+j]<cost_matrix[(size_t)current*numNodes+next]))
+                next = j;
+        total += cost_matrix[(size_t)current*numNodes+next];
+        visited[next] = true;
+        current = next;
+    }
+    return total+cost_matrix[(size_t)current*numNodes];
+}
+
+/**
+Minimum 1-tree with penalised costs c(i,j)+pi[i]+pi[j]: spanning tree of nodes 1..n-1 (Prim on the dense matrix, with
+    the key updates and the minimum search shared among the threads) plus the two cheapest edges of node 0
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  pi: Node penalties
+@param  degree: Written with the degree of each node in the 1-tree
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+
+@return     Penalised cost of the 1-tree
+*/
+double oneTree(const int *cost_matrix, int numNodes, const double *pi, int *degree, int numThreads){
+    vector<double> key(numNodes, DBL_MAX);
+    vector<int> parent(numNodes, -1);
+    vector<char> inTree(numNodes, 0);
+    double total,first,second,c,bestKey;
+    int j,best1,best2,bestNode,added;
+
+    fill(degree, degree+numNodes, 0);
+    total = 0;
+    key[1] = 0;
+    bestKey = DBL_MAX;
+    bestNode = -1;
+
+#pragma omp parallel num_threads(numThreads) if(numNodes>=BOUNDPARALLEL)
+    {
+        int step,v,localNode;
+        double localKey,w;
+        for (step=0; step<numNodes-1; ++step){
+            // closest node to the tree
+            localKey = DBL_MAX;
+            localNode = -1;
+#pragma omp for
+            for (v=1; v<numNodes; ++v)
+                if (!inTree[v] && key[v]<localKey){
+                    localKey = key[v];
+                    localNode = v;
+                }
+#pragma omp critical
+            {
+                if (localNode>=0 && (localKey<bestKey || (localKey==bestKey && localNode<bestNode))){
+                    bestKey = localKey;
+                    bestNode = localNode;
+                }
+            }
+#pragma omp barrier
+#pragma omp single
+            {
+                added = bestNode;
+                inTree[added] = 1;
+                if (parent[added] >= 0){
+                    total += key[added];
+                    ++degree[added];
+                    ++degree[parent[added]];
+                }
+                bestKey = DBL_MAX;
+                bestNode = -1;
+            }
+            // keys of the remaining nodes through the added one
+#pragma omp for
+            for (v=1; v<numNodes; ++v)
+                if (!inTree[v]){
+                    w = cost_matrix[(size_t)added*numNodes+v]+pi[added]+pi[v];
+                    if (w < key[v]){
+                        key[v] = w;
+                        parent[v] = added;
+                    }
+                }
+        }
+    }
+
+    // node 0: two cheapest penalised edges
+    first = second = DBL_MAX;
+    best1 = best2 = -1;
+    for (j=1; j<numNodes; ++j){
+        c = cost_matrix[j]+pi[0]+pi[j];
+        if (c < first){
+            second = first;
+            best2 = best1;
+            first = c;
+            best1 = j;
+        }
+        else if (c < second){
+            second = c;
+            best2 = j;
+        }
+    }
+    total += first+second;
+    degree[0] = 2;
+    ++degree[best1];
+    ++degree[best2];
+    return total;
+}
+
+/**
+Held-Karp lower bound: maximises over the node penalties pi the cost of the minimum 1-tree minus 2*sum(pi), moving pi
+    along the subgradient (degree-2) with Polyak steps towards the nearest neighbour tour cost
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+
+@return     Lower bound of the cost of any tour
+*/
+long long heldKarpBound(const int *cost_matrix, int numNodes, int numThreads){
+    vector<double> pi(numNodes, 0);
+    vector<int> degree(numNodes);
+    double bound,best,lambda,step,norm,sumPi;
+    long long upper;
+    int it,i,stale;
+
+    upper = nearestNeighbourCost(cost_matrix, numNodes);
+    if (numNodes <= 3)      // a single tour
+        return upper;
+
+    best = -DBL_MAX;
+    lambda = 2;
+    stale = 0;
+    for (it=0; it<BOUNDITERATIONS; ++it){
+        bound = oneTree(cost_matrix, numNodes, pi.data(), degree.data(), numThreads);
+        sumPi = 0;
+        norm = 0;
+        for (i=0; i<numNodes; ++i){
+            sumPi += pi[i];
+            norm += (degree[i]-2)*(degree[i]-2);
+        }
+        bound -= 2*sumPi;
+        if (bound > best+1e-9){
+            best = bound;
+            stale = 0;
+        }
+        else if (++stale == BOUNDPATIENCE){
+            lambda /= 2;
+            stale = 0;
+        }
+        if (norm == 0)      // the 1-tree is a tour: optimal
+            break;
+        step = lambda*(upper-bound)/norm;
+        if (step < 1e-6)
+            break;
+        for (i=0; i<numNodes; ++i)
+            pi[i] += step*(degree[i]-2);
+    }
+    return (long long)ceil(best-1e-6);
+}
+
+#endif
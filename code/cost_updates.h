@@ -0,0 +1,198 @@
+/**
+cost_updates.h
+Purpose: Edge cost updates applied to the cost matrix while the genetic algorithm is running: batches are queued by
+    queueCostUpdate (any thread of a program that embeds the engine) or read from a local feed (--cost-feed: a file
+    appended to, or a named pipe, of "a b cost" lines) and applied between two generations; only the parents survive
+    a generation, so only the parents that contain an updated edge get their cost changed (by the difference of the
+    edge costs, found with a bitmap of the updated endpoints) and are sorted again, the population keeps its progress
+
+@author Danilo Franco
+*/
+
+#ifndef COST_UPDATES_H
+#define COST_UPDATES_H
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>    // stable_sort
+#include <fcntl.h>      // open
+#include <unistd.h>     // read, close
+
+#include "population.h"
+#include "parallel_backend.h"
+#include "genetic_utils.h"      // move_top
+
+#define FEEDCHUNK 65536     // bytes read from the feed at once
+
+/**
+New cost of the undirected edge (a,b)
+*/
+struct EdgeUpdate {
+    int a;
+    int b;
+    int cost;
+};
+
+atomic<bool> dynamicCosts(false);   // whether updates may be queued (feed open or queueCostUpdate called)
+vector<EdgeUpdate> pendingUpdates;  // queued updates, applied together at the next generation
+mutex pendingMutex;
+int costFeed = -1;                  // descriptor of the feed (-1: none)
+string feedLine;                    // incomplete last line read from the feed
+
+/**
+Queues the update of an edge cost (thread safe); it is applied between two generations together with the other
+    updates queued in the meantime
+
+@param  a: First node
+@param  b: Second node
+@param  cost: New cost of the edge
+*/
+void queueCostUpdate(int a, int b, int cost){
+    lock_guard<mutex> lock(pendingMutex);
+    pendingUpdates.push_back({a, b, cost});
+    dynamicCosts = true;
+}
+
+/**
+Opens the feed of cost updates (not blocking: a named pipe may be opened before any writer)
+
+@param  feed_f: Path to the feed
+
+@return     False if the feed cannot be opened
+*/
+bool openCostFeed(const char *feed_f){
+    costFeed = open(feed_f, O_RDONLY|O_NONBLOCK);
+    if (costFeed < 0)
+        return false;
+    dynamicCosts = true;
+    return true;
+}
+
+/**
+Queues the complete lines available on the feed (the last line stays pending until its end arrives)
+*/
+void pollCostFeed(){
+    char buff[FEEDCHUNK];
+    ssize_t len;
+    size_t start,end;
+    int a,b,cost;
+
+    if (costFeed < 0)
+        return;
+    while ((len = read(costFeed, buff, FEEDCHUNK)) > 0)
+        feedLine.append(buff, len);
+    for (start=0; (end = feedLine.find('\n', start))!=string::npos; start=end+1){
+        if (sscanf(feedLine.c_str()+start, "%d %d %d", &a, &b, &cost) == 3)
+            queueCostUpdate(a, b, cost);
+        else if (end > start)
+            cerr << "Cost feed: invalid line skipped" << endl;
+    }
+    feedLine.erase(0, start);
+}
+
+/**
+Takes the queued updates (feed included)
+
+@param  updates: Written with the batch
+
+@return     True iff the batch is not empty
+*/
+bool takeCostUpdates(vector<EdgeUpdate> &updates){
+    pollCostFeed();
+    lock_guard<mutex> lock(pendingMutex);
+    updates.swap(pendingUpdates);
+    pendingUpdates.clear();
+    return !updates.empty();
+}
+
+#ifdef MPI_VERSION
+/**
+Sends the batch of node 0 to every node, so that all the nodes keep the same cost matrix
+
+@param  updates: Batch (read on node 0, written on the others)
+*/
+void bcastCostUpdates(vector<EdgeUpdate> &updates){
+    int count = updates.size();
+    MPI_Bcast(&count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    updates.resize(count);
+    if (count > 0)
+        MPI_Bcast(updates.data(), 3*count, MPI_INT, 0, MPI_COMM_WORLD);
+}
+#endif
+
+/**
+Applies a batch to the (symmetric) cost matrix and to the parents on top of the population: the parents containing
+    an updated edge get their cost changed by the cost differences and all the parents are sorted again
+
+@param  updates: Batch (invalid updates are skipped)
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  pop: Population whose first bestNum rows are the sorted parents
+@param  bestNum: Number of best elements (parents) that will produce the next generation
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+
+@return     Number of parents whose cost changed
+*/
+int applyCostUpdates(const vector<EdgeUpdate> &updates, int *cost_matrix, Population *pop, int bestNum, int numThreads){
+    unordered_map<long long, int> delta;    // cost change of each updated edge (key: smaller node * numNodes + larger)
+    vector<char> touched;
+    vector<int> rank, sorted;
+    atomic<int> changed(0);
+    int numNodes,u,v,p;
+
+    numNodes = pop->numNodes;
+    touched.assign(numNodes, 0);
+    for (const EdgeUpdate &e : updates){
+        if (e.a<0 || e.a>=numNodes || e.b<0 || e.b>=numNodes || e.a==e.b || e.cost<0){
+            cerr << "Cost update (" << e.a << "," << e.b << ") skipped" << endl;
+            continue;
+        }
+        u = min(e.a, e.b);
+        v = max(e.a, e.b);
+        delta[(long long)u*numNodes+v] += e.cost-cost_matrix[(size_t)u*numNodes+v];
+        cost_matrix[(size_t)u*numNodes+v] = e.cost;
+        cost_matrix[(size_t)v*numNodes+u] = e.cost;
+        touched[u] = 1;
+        touched[v] = 1;
+    }
+    if (delta.empty())
+        return 0;
+
+    // PARENTS containing an updated edge (both endpoints touched)
+    parallel_for(numThreads, 0, bestNum, [&](int p){
+        const int *tour = row(pop, p);
+        int j,a,b;
+        long long change = 0;
+        for (j=0; j<numNodes; ++j){
+            a = tour[j];
+            b = tour[j+1<numNodes ? j+1 : 0];
+            if (touched[a] && touched[b]){
+                auto it = delta.find((long long)min(a, b)*numNodes+max(a, b));
+                if (it != delta.end())
+                    change += it->second;
+            }
+        }
+        if (change != 0){
+            pop->cost[p] += change;
+            changed.fetch_add(1, memory_order_relaxed);
+        }
+    });
+
+    // SORT the parents again
+    rank.resize(bestNum);
+    for (p=0; p<bestNum; ++p)
+        rank[p] = p;
+    stable_sort(rank.begin(), rank.end(), [&](int x, int y){
+        return pop->cost[x] < pop->cost[y];
+    });
+    sorted.resize(bestNum);
+    for (p=0; p<bestNum; ++p)
+        sorted[p] = pop->cost[rank[p]];
+    move_top(rank.data(), pop, bestNum, 0);
+    copy(sorted.begin(), sorted.end(), pop->cost);
+    return changed.load();
+}
+
+#endif
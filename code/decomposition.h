@@ -0,0 +1,313 @@
+/**
+decomposition.h
+Purpose: Divide-and-conquer mode of genetic_engine.h for very large instances: the nodes are partitioned with k-medoids
+    on the cost matrix, every cluster is solved by genetic_tsp on its own sub-matrix (clusters shared among the threads
+    and, under MPI, among the nodes), the sub-tours are stitched following a tour of the medoids and the junctions are
+    repaired with 2-opt moves in a window around each of them
+
+@author Danilo Franco
+*/
+
+#ifndef DECOMPOSITION_H
+#define DECOMPOSITION_H
+
+#include <vector>
+#include <algorithm>    // sort, min
+#include <climits>      // INT_MAX
+#include <chrono>
+
+#include "genetic_utils.h"
+#include "exact_utils.h"
+#include "local_search.h"
+
+#define DECOMPITERATIONS 10     // maximum k-medoids iterations
+#define DECOMPMINSIZE 4         // minimum average number of nodes per cluster (fewer clusters are used otherwise)
+#define DECOMPWINDOW 100        // positions on each side of a junction touched by the repair phase
+
+int decomposeClusters = 0;      // number of clusters of the decomposition mode (0: the instance is solved as a whole)
+
+int* genetic_tsp(int me, int numInstances, int numThreads, int *cost_matrix, int numNodes, int population, double top, int maxIt, double mutatProb, int earlyStopRounds, double earlyStopParam);
+
+/**
+Partitions the nodes with k-medoids: medoids seeded k-medoids++ style (each one drawn with probability proportional to
+    the cost from the closest medoid already chosen), then nodes assigned to the closest medoid and medoids moved to
+    the node of their cluster with the least total cost from the others, until they stop moving
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  k: Number of clusters
+@param  medoids: Written with the medoid of each cluster (k elements)
+@param  cluster: Written with the cluster of each node (numNodes elements)
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+
+@return     Number of clusters (less than k if fewer nodes are distinct)
+*/
+int kMedoids(const int *cost_matrix, int numNodes, int k, int *medoids, int *cluster, int numThreads){
+    vector<double> dist(numNodes);
+    vector<vector<int> > members;
+    vector<char> moved;
+    double total,pick;
+    int c,i,it;
+    bool changed;
+
+    // SEEDING
+    medoids[0] = randomBelow(numNodes);
+    for (i=0; i<numNodes; ++i)
+        dist[i] = cost_matrix[(size_t)medoids[0]*numNodes+i];
+    for (c=1; c<k; ++c){
+        total = 0;
+        for (i=0; i<numNodes; ++i)
+            total += dist[i];
+        if (total <= 0)     // every node coincides with a medoid
+            break;
+        pick = total*(random32()/4294967296.0);
+        for (i=0; i<numNodes && (dist[i]==0 || pick>=dist[i]); ++i)
+            pick -= dist[i];
+        if (i == numNodes)  // rounding: last node not yet chosen
+            for (i=numNodes-1; dist[i]==0; --i);
+        medoids[c] = i;
+        for (int j=0; j<numNodes; ++j)
+            dist[j] = min(dist[j], (double)cost_matrix[(size_t)medoids[c]*numNodes+j]);
+    }
+    k = c;
+
+    members.resize(k);
+    moved.resize(k);
+    for (it=0; ; ++it){
+        // ASSIGNMENT to the closest medoid
+        parallel_for(numThreads, 0, numNodes, [&](int i){
+            int best = 0;
+            for (int c=1; c<k; ++c)
+                if (cost_matrix[(size_t)medoids[c]*numNodes+i] < cost_matrix[(size_t)medoids[best]*numNodes+i])
+                    best = c;
+            cluster[i] = best;
+        });
+        for (c=0; c<k; ++c)     // no empty cluster, even with coincident nodes
+            cluster[medoids[c]] = c;
+        if (it == DECOMPITERATIONS)
+            break;
+
+        // UPDATE of the medoids
+        for (c=0; c<k; ++c)
+            members[c].clear();
+        for (i=0; i<numNodes; ++i)
+            members[cluster[i]].push_back(i);
+        parallel_for(numThreads, 0, k, [&](int c){
+            long long sum,bestSum;
+            int best = medoids[c];
+            bestSum = LLONG_MAX;
+            for (int m : members[c]){
+                sum = 0;
+                for (int j : members[c])
+                    sum += cost_matrix[(size_t)m*numNodes+j];
+                if (sum < bestSum){
+                    bestSum = sum;
+                    best = m;
+                }
+            }
+            moved[c] = best!=medoids[c];
+            medoids[c] = best;
+        });
+        changed = false;
+        for (c=0; c<k; ++c)
+            changed = changed || moved[c];
+        if (!changed)
+            break;
+    }
+    return k;
+}
+
+/**
+Joins the sub-tours of the clusters in the given order: each closed sub-tour is opened at the edge whose removal,
+    together with the edges towards the previous node and the next medoid, costs the least, in either direction
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  k: Number of clusters
+@param  order: Visiting order of the clusters
+@param  medoids: Medoid of each cluster
+@param  tours: Sub-tours of the clusters, one after the other (global node indices)
+@param  offset: Position of each sub-tour in tours (k+1 elements)
+@param  tour: Written with the whole tour
+@param  junctions: Written with the position in tour of the first node of each cluster (in visiting order)
+*/
+void stitchClusters(const int *cost_matrix, int numNodes, int k, const int *order, const int *medoids, const int *tours, const int *offset, int *tour, int *junctions){
+    int p,c,s,j,i,pos,a,b,in,out,bestJ,delta,best;
+    const int *seg;
+    bool forward;
+
+    pos = 0;
+    for (p=0; p<k; ++p){
+        c = order[p];
+        s = offset[c+1]-offset[c];
+        seg = tours+offset[c];
+        in = p==0 ? medoids[order[k-1]] : tour[pos-1];
+        out = p<k-1 ? medoids[order[p+1]] : tour[0];
+
+        best = INT_MAX;
+        bestJ = 0;
+        forward = true;
+        for (j=0; j<s; ++j){
+            a = seg[j];
+            b = seg[(j+1)%s];
+            // enter in b and leave from a
+            delta = cost_matrix[(size_t)in*numNodes+b]+cost_matrix[(size_t)a*numNodes+out]-cost_matrix[(size_t)a*numNodes+b];
+            if (delta < best){
+                best = delta;
+                bestJ = j;
+                forward = true;
+            }
+            // enter in a and leave from b
+            delta = cost_matrix[(size_t)in*numNodes+a]+cost_matrix[(size_t)b*numNodes+out]-cost_matrix[(size_t)a*numNodes+b];
+            if (delta < best){
+                best = delta;
+                bestJ = j;
+                forward = false;
+            }
+        }
+
+        junctions[p] = pos;
+        for (i=0; i<s; ++i)
+            tour[pos+i] = forward ? seg[(bestJ+1+i)%s] : seg[(bestJ-i+s)%s];
+        pos += s;
+    }
+}
+
+/**
+Solves the instance by decomposition (the caller must prevent genetic_tsp from decomposing the clusters again)
+
+@param  me: Index of the current executing node in the cluster (0 when not running under MPI)
+@param  numInstances: Amount of nodes currently working on finding the solution (1 when not running under MPI)
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  numClusters: Number of clusters (reduced to keep at least DECOMPMINSIZE nodes per cluster on average)
+@param  population, top, maxIt, mutatProb, earlyStopRounds, earlyStopParam: genetic_tsp settings for each cluster
+
+@return     Pointer to the found nodes permutation (integer index) + solution cost + convergence boolean (every cluster
+            converged) + iterations count (of the longest cluster)
+*/
+int* decomposed_tsp(int me, int numInstances, int numThreads, int *cost_matrix, int numNodes, int numClusters, int population, double top, int maxIt, double mutatProb, int earlyStopRounds, double earlyStopParam){
+    int k,c,p,i,*solution;
+    vector<int> cluster(numNodes), medoids, offset, sizeOrder, mine, tours(numNodes, 0), order, junctions, converged, iterations;
+    vector<vector<int> > members;
+    chrono::high_resolution_clock::time_point t_start, t_end;
+    chrono::duration<double> exec_time;
+
+    k = min(numClusters, numNodes/DECOMPMINSIZE);
+    if (k < 2)
+        return genetic_tsp(me, numInstances, numThreads, cost_matrix, numNodes, population, top, maxIt, mutatProb, earlyStopRounds, earlyStopParam);
+
+    // CLUSTERING (the partition of node 0 is used by every node)
+    t_start = chrono::high_resolution_clock::now();
+    medoids.resize(k);
+    k = kMedoids(cost_matrix, numNodes, k, medoids.data(), cluster.data(), numThreads);
+#ifdef MPI_VERSION
+    MPI_Bcast(&k, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(medoids.data(), k, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(cluster.data(), numNodes, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+    medoids.resize(k);
+    members.resize(k);
+    for (i=0; i<numNodes; ++i)
+        members[cluster[i]].push_back(i);
+    offset.assign(k+1, 0);
+    for (c=0; c<k; ++c)
+        offset[c+1] = offset[c]+members[c].size();
+    t_end = chrono::high_resolution_clock::now();
+    exec_time = t_end-t_start;
+#ifdef PRINTSCOST
+    printf("decomposition in %d clusters: %f\n",k,exec_time.count());
+#endif
+
+    // SUB-PROBLEMS: largest clusters first, dealt round-robin to the nodes and solved as tasks by the threads
+    t_start = chrono::high_resolution_clock::now();
+    sizeOrder.resize(k);
+    for (c=0; c<k; ++c)
+        sizeOrder[c] = c;
+    sort(sizeOrder.begin(), sizeOrder.end(), [&](int a, int b){ return members[a].size() > members[b].size(); });
+    for (p=me; p<k; p+=numInstances)
+        mine.push_back(sizeOrder[p]);
+    converged.assign(k, 1);
+    iterations.assign(k, 0);
+
+    parallel_region(numThreads, [&](){
+        parallel_tasks(mine.size(), [&](int t){
+            int c,s,i,j,*sub_matrix,*sub;
+            c = mine[t];
+            s = members[c].size();
+            if (s <= 3){    // every order is optimal
+                copy(members[c].begin(), members[c].end(), tours.begin()+offset[c]);
+                return;
+            }
+            sub_matrix = new int[s*s];
+            for (i=0; i<s; ++i)
+                for (j=0; j<s; ++j)
+                    sub_matrix[i*s+j] = cost_matrix[(size_t)members[c][i]*numNodes+members[c][j]];
+            sub = genetic_tsp(0, 1, 1, sub_matrix, s, population, top, maxIt, mutatProb, earlyStopRounds, earlyStopParam);
+            for (i=0; i<s; ++i)
+                tours[offset[c]+i] = members[c][sub[i]];
+            converged[c] = sub[s+1];
+            iterations[c] = sub[s+2];
+            delete[] sub;
+            delete[] sub_matrix;
+        });
+    });
+#ifdef MPI_VERSION
+    // the sub-tours of the other nodes are zero
+    MPI_Allreduce(MPI_IN_PLACE, tours.data(), numNodes, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, converged.data(), k, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, iterations.data(), k, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+#endif
+    t_end = chrono::high_resolution_clock::now();
+    exec_time = t_end-t_start;
+#ifdef PRINTSCOST
+    printf("clusters solved: %f\n",exec_time.count());
+#endif
+
+    // STITCHING along a tour of the medoids
+    t_start = chrono::high_resolution_clock::now();
+    vector<int> medoid_matrix(k*k);
+    for (c=0; c<k; ++c)
+        for (p=0; p<k; ++p)
+            medoid_matrix[c*k+p] = cost_matrix[(size_t)medoids[c]*numNodes+medoids[p]];
+    order.resize(k);
+    if (exact_tsp(medoid_matrix.data(), k, order.data()) < 0)
+        exact_startTour(medoid_matrix.data(), k, order);
+
+    solution = new int[numNodes+3];
+    junctions.resize(k);
+    stitchClusters(cost_matrix, numNodes, k, order.data(), medoids.data(), tours.data(), offset.data(), solution, junctions.data());
+    t_end = chrono::high_resolution_clock::now();
+    exec_time = t_end-t_start;
+#ifdef PRINTSCOST
+    printf("stitching (cost %lld): %f\n",tourCost(cost_matrix, numNodes, solution),exec_time.count());
+#endif
+
+    // REPAIR: disjoint windows across the junctions, each reaching at most half of the two clusters
+    t_start = chrono::high_resolution_clock::now();
+    parallel_for(numThreads, 0, k, [&](int p){
+        int before,after;
+        before = offset[order[(p+k-1)%k]+1]-offset[order[(p+k-1)%k]];
+        after = offset[order[p]+1]-offset[order[p]];
+        before = min(DECOMPWINDOW, before-before/2);
+        after = min(DECOMPWINDOW, after/2);
+        twoOpt_window(solution, numNodes, cost_matrix, junctions[p]-before, before+after);
+    });
+    solution[numNodes] = tourCost(cost_matrix, numNodes, solution);
+    t_end = chrono::high_resolution_clock::now();
+    exec_time = t_end-t_start;
+#ifdef PRINTSCOST
+    printf("junctions repaired (cost %d): %f\n",solution[numNodes],exec_time.count());
+#endif
+
+    solution[numNodes+1] = 1;
+    solution[numNodes+2] = 0;
+    for (c=0; c<k; ++c){
+        solution[numNodes+1] = solution[numNodes+1] && converged[c];
+        solution[numNodes+2] = max(solution[numNodes+2], iterations[c]);
+    }
+    return solution;
+}
+
+#endif
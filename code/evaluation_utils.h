@@ -0,0 +1,89 @@
+/**
+evaluation_utils.h
+Purpose: Fitness evaluation for genetic_utils.h: tour costs and hashes computed on EVALLANES tours in lockstep, so that
+    the independent cost_matrix loads of different tours overlap, with software prefetch of the cells PREFETCHDIST
+    steps ahead (both hide the memory latency of the random matrix accesses at large numbers of nodes)
+
+@author Danilo Franco
+*/
+
+#ifndef EVALUATION_UTILS_H
+#define EVALUATION_UTILS_H
+
+#include <cstddef>      // size_t
+
+#include "parallel_backend.h"
+#include "population.h"
+
+#define EVALLANES 4         // tours evaluated in lockstep by each thread
+#define PREFETCHDIST 8      // how many edges ahead the matrix cell is prefetched
+
+/**
+Computes cost and hash of LANES tours in lockstep
+
+@param  tours: Pointers to the LANES permutations
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  costs: Written with the LANES tour costs
+@param  hashes: Written with the LANES tour hashes
+*/
+template <int LANES>
+inline void evaluate_lanes(const int *const *tours, const int *cost_matrix, int numNodes, int *costs, unsigned long long *hashes){
+    int j,k,source[LANES],destination;
+    size_t n = numNodes;
+
+    // cost of last node linked to the first one
+    for (k=0; k<LANES; ++k){
+        source[k] = tours[k][numNodes-1];
+        costs[k] = cost_matrix[source[k]*n+tours[k][0]];
+        hashes[k] = edgeHash(source[k], tours[k][0]);
+        source[k] = tours[k][0];
+    }
+    // cost of adjacent cells, prefetching the cell PREFETCHDIST edges ahead
+    for (j=1; j<numNodes-PREFETCHDIST; ++j){
+        for (k=0; k<LANES; ++k){
+            __builtin_prefetch(cost_matrix+tours[k][j+PREFETCHDIST-1]*n+tours[k][j+PREFETCHDIST], 0, 3);
+            destination = tours[k][j];
+            costs[k] += cost_matrix[source[k]*n+destination];
+            hashes[k] += edgeHash(source[k], destination);
+            source[k] = destination;
+        }
+    }
+    for (; j<numNodes; ++j){
+        for (k=0; k<LANES; ++k){
+            destination = tours[k][j];
+            costs[k] += cost_matrix[source[k]*n+destination];
+            hashes[k] += edgeHash(source[k], destination);
+            source[k] = destination;
+        }
+    }
+}
+
+/**
+Computes the cost and hash of the rows [first, first+count) of a population, EVALLANES at a time
+
+@param  pop: Population whose rows are evaluated
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  first: First row to be evaluated
+@param  count: Number of rows to be evaluated
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+*/
+void evaluate_rows(Population *pop, const int *cost_matrix, int first, int count, int numThreads){
+    int numGroups = (count+EVALLANES-1)/EVALLANES;
+
+    parallel_for(numThreads, 0, numGroups, [&](int g){
+        const int *tours[EVALLANES];
+        int k,i,lanes;
+        i = first+g*EVALLANES;
+        lanes = min(EVALLANES, first+count-i);
+        for (k=0; k<lanes; ++k)
+            tours[k] = row(pop, i+k);
+        if (lanes == EVALLANES)
+            evaluate_lanes<EVALLANES>(tours, cost_matrix, pop->numNodes, pop->cost+i, pop->hash+i);
+        else
+            for (k=0; k<lanes; ++k)
+                evaluate_lanes<1>(tours+k, cost_matrix, pop->numNodes, pop->cost+i+k, pop->hash+i+k);
+    });
+}
+
+#endif
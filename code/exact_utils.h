@@ -0,0 +1,258 @@
+/**
+exact_utils.h
+Purpose: Exact solvers for small instances, used by genetic_engine.h instead of the genetic algorithm: Held-Karp
+    dynamic programming over subsets up to EXACTDP nodes, depth-first branch-and-bound up to EXACTBB nodes
+
+@author Danilo Franco
+*/
+
+#ifndef EXACT_UTILS_H
+#define EXACT_UTILS_H
+
+#include <vector>
+#include <algorithm>    // sort, min
+#include <climits>      // INT_MAX
+
+#define EXACTDP 18              // largest instance solved by dynamic programming (2^(n-1)*(n-1) states)
+#define EXACTBB 20              // largest instance solved by branch-and-bound
+#define EXACTBBNODES 20000000   // branch-and-bound search nodes after which it gives up
+
+/**
+Held-Karp dynamic programming: cost[S][j] is the cheapest path from node 0 through the set S of the other nodes
+    ending in j; states are stored mask-major (the n-1 last nodes of a set are contiguous) with one byte per state
+    to rebuild the tour
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem (at most EXACTDP)
+@param  tour: Written with the optimal permutation
+
+@return     Optimal tour cost
+*/
+int exact_dp(const int *cost_matrix, int numNodes, int *tour){
+    int m,full,mask,j,k,next,last,best,c,*cost;
+    unsigned char *pred;
+
+    m = numNodes-1;
+    full = 1<<m;
+    cost = new int[(size_t)full*m];
+    pred = new unsigned char[(size_t)full*m];
+    fill(cost, cost+(size_t)full*m, INT_MAX);
+
+    for (j=0; j<m; ++j)
+        cost[(size_t)(1<<j)*m+j] = cost_matrix[j+1];
+    for (mask=1; mask<full; ++mask)
+        for (j=0; j<m; ++j){
+            c = cost[(size_t)mask*m+j];
+            if (c==INT_MAX || !(mask&(1<<j)))
+                continue;
+            for (k=0; k<m; ++k){
+                if (mask&(1<<k))
+                    continue;
+                next = mask|(1<<k);
+                if (c+cost_matrix[(j+1)*numNodes+k+1] < cost[(size_t)next*m+k]){
+                    cost[(size_t)next*m+k] = c+cost_matrix[(j+1)*numNodes+k+1];
+                    pred[(size_t)next*m+k] = j;
+                }
+            }
+        }
+
+    // close the tour and walk it back
+    best = INT_MAX;
+    last = 0;
+    for (j=0; j<m; ++j){
+        c = cost[(size_t)(full-1)*m+j]+cost_matrix[(j+1)*numNodes];
+        if (c < best){
+            best = c;
+            last = j;
+        }
+    }
+    tour[0] = 0;
+    mask = full-1;
+    for (k=m; k>=1; --k){
+        tour[k] = last+1;
+        j = pred[(size_t)mask*m+last];
+        mask ^= 1<<last;
+        last = j;
+    }
+
+    delete[] cost;
+    delete[] pred;
+    return best;
+}
+
+/**
+State of the branch-and-bound search
+*/
+struct ExactSearch {
+    const int *cost_matrix;
+    int numNodes;
+    vector<int> order;          // order[i*numNodes+k]: k-th closest node to i
+    vector<int> minEdge;        // cheapest edge of each node
+    vector<int> twoEdges;       // sum of the two cheapest edges of each node
+    vector<int> path, bestTour;
+    vector<bool> visited;
+    int best;
+    long nodes;
+};
+
+/**
+Extends the partial tour path[0..depth) (cost partial) in every promising way; the path still to be added goes from
+    the new last node through the unvisited ones back to node 0, so its cost is bounded both by the cheapest edge
+    leaving each of its nodes and by half the cheapest edges touching each of its ends (one for the last node and
+    node 0, two for the unvisited ones)
+
+@param  s: Search state
+@param  depth: Length of the partial tour
+@param  partial: Cost of the partial tour
+@param  remaining: Sum of the cheapest edges of the unvisited nodes
+@param  remainingTwo: Sum of the two cheapest edges of the unvisited nodes
+*/
+void exact_branch(ExactSearch &s, int depth, int partial, int remaining, int remainingTwo){
+    int n,last,k,next,c,ends;
+    n = s.numNodes;
+    last = s.path[depth-1];
+    if (++s.nodes > EXACTBBNODES)
+        return;
+    if (depth == n){
+        c = partial+s.cost_matrix[last*n];
+        if (c < s.best){
+            s.best = c;
+            s.bestTour = s.path;
+        }
+        return;
+    }
+    for (k=0; k<n; ++k){
+        next = s.order[last*n+k];
+        if (s.visited[next])
+            continue;
+        c = partial+s.cost_matrix[last*n+next];
+        if (c+remaining >= s.best)
+            continue;
+        ends = s.minEdge[next]+s.minEdge[0]+remainingTwo-s.twoEdges[next];
+        if (c+(ends+1)/2 >= s.best)
+            continue;
+        s.visited[next] = true;
+        s.path[depth] = next;
+        exact_branch(s, depth+1, c, remaining-s.minEdge[next], remainingTwo-s.twoEdges[next]);
+        s.visited[next] = false;
+    }
+}
+
+/**
+Starting tour of the branch-and-bound: nearest neighbour tour improved by 2-opt moves until none applies
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  tour: Written with the tour
+
+@return     Tour cost
+*/
+int exact_startTour(const int *cost_matrix, int numNodes, vector<int> &tour){
+    vector<bool> visited(numNodes, false);
+    int i,j,k,a,b,c,d,next,total;
+    bool improved;
+
+    tour.assign(numNodes, 0);
+    visited[0] = true;
+    for (i=1; i<numNodes; ++i){
+        next = -1;
+        for (k=0; k<numNodes; ++k)
+            if (!visited[k] && (next<0 || cost_matrix[tour[i-1]*numNodes+k]<cost_matrix[tour[i-1]*numNodes+next]))
+                next = k;
+        tour[i] = next;
+        visited[next] = true;
+    }
+    do {
+        improved = false;
+        for (i=0; i<numNodes-1; ++i)
+            for (j=i+2; j<numNodes; ++j){
+                a = tour[i];
+                b = tour[i+1];
+                c = tour[j];
+                d = tour[(j+1)%numNodes];
+                if (d!=a && cost_matrix[a*numNodes+c]+cost_matrix[b*numNodes+d] < cost_matrix[a*numNodes+b]+cost_matrix[c*numNodes+d]){
+                    reverse(tour.begin()+i+1, tour.begin()+j+1);
+                    improved = true;
+                }
+            }
+    } while (improved);
+
+    total = cost_matrix[tour[numNodes-1]*numNodes+tour[0]];
+    for (i=0; i<numNodes-1; ++i)
+        total += cost_matrix[tour[i]*numNodes+tour[i+1]];
+    return total;
+}
+
+/**
+Depth-first branch-and-bound from node 0, children visited from the closest
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  tour: Written with the optimal permutation
+
+@return     Optimal tour cost, -1 if the search exceeded EXACTBBNODES nodes
+*/
+int exact_bb(const int *cost_matrix, int numNodes, int *tour){
+    ExactSearch s;
+    int i,k,remaining,remainingTwo,first,second;
+
+    s.cost_matrix = cost_matrix;
+    s.numNodes = numNodes;
+    s.order.resize(numNodes*numNodes);
+    s.minEdge.resize(numNodes);
+    s.twoEdges.resize(numNodes);
+    remaining = 0;
+    remainingTwo = 0;
+    for (i=0; i<numNodes; ++i){
+        for (k=0; k<numNodes; ++k)
+            s.order[i*numNodes+k] = k;
+        sort(s.order.begin()+i*numNodes, s.order.begin()+(i+1)*numNodes, [&](int a, int b){
+            return cost_matrix[i*numNodes+a] < cost_matrix[i*numNodes+b];
+        });
+        // the closest node to i is i itself (zero diagonal) unless an edge costs less
+        first = s.order[i*numNodes]!=i ? s.order[i*numNodes] : s.order[i*numNodes+1];
+        second = s.order[i*numNodes+1]!=i && s.order[i*numNodes+1]!=first ? s.order[i*numNodes+1] : s.order[i*numNodes+2];
+        s.minEdge[i] = cost_matrix[i*numNodes+first];
+        s.twoEdges[i] = s.minEdge[i]+cost_matrix[i*numNodes+second];
+        if (i > 0){
+            remaining += s.minEdge[i];
+            remainingTwo += s.twoEdges[i];
+        }
+    }
+
+    s.path.assign(numNodes, 0);
+    s.visited.assign(numNodes, false);
+    s.visited[0] = true;
+    s.best = exact_startTour(cost_matrix, numNodes, s.bestTour)+1;     // the start tour itself is found again
+    s.nodes = 0;
+    exact_branch(s, 1, 0, remaining, remainingTwo);
+
+    if (s.nodes > EXACTBBNODES)
+        return -1;
+    copy(s.bestTour.begin(), s.bestTour.end(), tour);
+    return s.best;
+}
+
+/**
+Solves small instances exactly
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  tour: Written with the optimal permutation
+
+@return     Optimal tour cost, -1 if the instance is too large (or the search gave up)
+*/
+int exact_tsp(const int *cost_matrix, int numNodes, int *tour){
+    if (numNodes <= 3){
+        for (int i=0; i<numNodes; ++i)
+            tour[i] = i;
+        return numNodes==2 ? 2*cost_matrix[1] : cost_matrix[1]+cost_matrix[1*numNodes+2]+cost_matrix[2*numNodes];
+    }
+    if (numNodes <= EXACTDP)
+        return exact_dp(cost_matrix, numNodes, tour);
+    if (numNodes <= EXACTBB)
+        return exact_bb(cost_matrix, numNodes, tour);
+    return -1;
+}
+
+#endif
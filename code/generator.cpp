@@ -1,29 +1,170 @@
-#include <iostream>
-#include <stdlib.h>
-#include <cmath>
+/**
+generator.cpp
+Purpose: Random instance generator for gen_tsp.cpp: writes a symmetric cost matrix either as text (xPos yPos Val,
+    upper triangle) or in the binary instance format of in_out.h; for the geometric families (see generator_utils.h)
+    the points can be written instead (one "node x y" line each)
 
-using namespace std;
+usage: gen numNodes [--mode random|euclid|cluster|grid|road] [--seed s] [--threads t] [--binary|--coords] [--out file]
 
-int main(int argc, const char* argv[]){
+@author Danilo Franco
+*/
+
+#include <ctime>
+#include <string>
+
+#include "in_out.h"
+#include "memory_utils.h"
+#include "generator_utils.h"
+
+#define ROWSBLOCK 64    // rows formatted in parallel before being written (text output)
+
+/**
+Appends the decimal representation of a non-negative integer to a buffer
+
+@param  buff: Buffer to be written
+@param  val: Value
+
+@return     Pointer to the first character after the written ones
+*/
+char* appendInt(char *buff, int val){
+    char digits[12];
+    int len = 0;
+    do {
+        digits[len++] = '0'+val%10;
+        val /= 10;
+    } while (val);
+    while (len)
+        *buff++ = digits[--len];
+    return buff;
+}
+
+/**
+Writes the coordinates of a geometric instance, one "node x y" line per point
+
+@param  xs: Pointer to the x coordinates
+@param  ys: Pointer to the y coordinates
+@param  numNodes: Number of travelling-nodes in the problem
+@param  pFile: Output stream
+
+@return     True iff everything has been written
+*/
+bool writeCoords(const double *xs, const double *ys, int numNodes, FILE *pFile){
+    for (int i=0; i<numNodes; ++i)
+        if (fprintf(pFile, "%d %.3f %.3f\n", i, xs[i], ys[i]) < 0)
+            return false;
+    return true;
+}
+
+/**
+Writes the upper triangle of a cost matrix as text, one "row col value" line per cell: blocks of ROWSBLOCK rows
+    are formatted in parallel and written in order with a single fwrite each
+
+@param  cost_matrix: Pointer to the first element of the matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  pFile: Output stream
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+
+@return     True iff everything has been written
+*/
+bool writeHeatMat(const int *cost_matrix, int numNodes, FILE *pFile, int numThreads){
+    int first,last,k;
+    vector<string> lines(ROWSBLOCK);
+
+    for (first=0; first<numNodes; first+=ROWSBLOCK){
+        last = min(first+ROWSBLOCK, numNodes);
+        parallel_for(numThreads, first, last, [&](int j){
+            string &out = lines[j-first];
+            char *buff, *pos;
+            // at most 3 numbers of 10 digits + separators per line
+            out.resize((size_t)(numNodes-j)*34);
+            buff = &out[0];
+            pos = buff;
+            for (int i=j; i<numNodes; ++i){
+                pos = appendInt(pos, j);
+                *pos++ = ' ';
+                pos = appendInt(pos, i);
+                *pos++ = ' ';
+                pos = appendInt(pos, cost_matrix[(size_t)j*numNodes+i]);
+                *pos++ = '\n';
+            }
+            out.resize(pos-buff);
+        });
+        for (k=0; k<last-first; ++k)
+            if (fwrite(lines[k].data(), 1, lines[k].size(), pFile) != lines[k].size())
+                return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]){
     if (argc<2){
         cerr << "need 1 args: nodes number\n";
         return 1;
     }
 
-    srand(time(NULL));
+    int numNodes,numThreads,mode,*cost_matrix;
+    unsigned long long seed;
+    bool binary,coords,written;
+    double *xs,*ys;
+    const char *val,*output_f;
+    FILE *pFile;
 
-    int rnd_val,numNodes,i,j;
-    
     numNodes = atoi(argv[1]);
+    val = getOption(argc, argv, 2, "--seed");
+    seed = val!=NULL ? strtoull(val, NULL, 10) : time(NULL);
+    val = getOption(argc, argv, 2, "--threads");
+    numThreads = val!=NULL ? atoi(val) : 1;
+    val = getOption(argc, argv, 2, "--mode");
+    mode = val!=NULL ? genMode(val) : GEN_RANDOM;
+    output_f = getOption(argc, argv, 2, "--out");
+    binary = false;
+    coords = false;
+    for (int i=2; i<argc; ++i){
+        if (strcmp(argv[i], "--binary")==0)
+            binary = true;
+        if (strcmp(argv[i], "--coords")==0)
+            coords = true;
+    }
+
+    if (numNodes<=1 || numThreads<1 || mode<0 ||
+        (coords && (binary || mode==GEN_RANDOM))){     // only geometric families have points
+        cerr <<"Invalid arguments!"<< endl;
+        return 1;
+    }
+    // printed so that every instance can be generated again
+    cerr << "seed " << seed << endl;
+
+    pFile = output_f!=NULL ? fopen(output_f, "wb") : stdout;
+    if (pFile == NULL){
+        cerr << "Cannot open " << output_f << endl;
+        return 1;
+    }
+
+    if (coords){
+        xs = new double[numNodes];
+        ys = new double[numNodes];
+        genPoints(mode, xs, ys, numNodes, seed);
+        written = writeCoords(xs, ys, numNodes, pFile);
+        delete[] xs;
+        delete[] ys;
+    }
+    else {
+        cost_matrix = allocLarge<int>((size_t)numNodes*numNodes);
+        genInstance(mode, cost_matrix, numNodes, seed, numThreads);
 
-    for (j=0; j<numNodes; j++) {
-        cout << j << ' ' << j << ' ' << 0 <<endl;
-        for (i=j+1; i<numNodes; i++) {
-            rnd_val = rand()%100+1; // 1 to 100
-            if (rnd_val > 80)
-                rnd_val = rnd_val*2;
-            cout << j << ' ' << i << ' ' << rnd_val <<endl;
-        } 
+        if (binary)
+            written = writeBinMat(cost_matrix, numNodes, pFile);
+        else
+            written = writeHeatMat(cost_matrix, numNodes, pFile, numThreads);
+        freeLarge(cost_matrix, (size_t)numNodes*numNodes);
+    }
+
+    if (pFile != stdout)
+        fclose(pFile);
+
+    if (!written){
+        cerr << "Write error" << endl;
+        return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,209 @@
+/**
+generator_utils.h
+Purpose: Random instance (symmetric cost matrix) generation for generator.cpp: every row (or point) draws from its
+    own stream derived from the seed, so the instance only depends on (mode, numNodes, seed) and not on the number
+    of threads. Families:
+        random:  uniform random weights (no triangle inequality, no locality)
+        euclid:  points uniform in a square, rounded Euclidean distances
+        cluster: points normally distributed around random centres, rounded Euclidean distances
+        grid:    points on a square lattice (randomly labelled), rounded Euclidean distances
+        road:    points uniform in a square, Manhattan distances stretched by a random per-road detour factor
+
+@author Danilo Franco
+*/
+
+#ifndef GENERATOR_UTILS_H
+#define GENERATOR_UTILS_H
+
+#include <cmath>
+#include <cstring>      // strcmp
+
+#include "rng_utils.h"
+#include "parallel_backend.h"
+
+#define GEN_RANDOM 0
+#define GEN_EUCLID 1
+#define GEN_CLUSTER 2
+#define GEN_GRID 3
+#define GEN_ROAD 4
+
+#define GENSPACING 100      // side of the square = GENSPACING*sqrt(numNodes): about GENSPACING/2 to the nearest point
+#define CLUSTERSIZE 100     // average points per cluster
+#define ROADDETOUR 0.3      // maximum relative detour of a road with respect to the Manhattan distance
+
+/**
+Returns the generator mode of a command line name
+
+@param  name: "random", "euclid", "cluster", "grid" or "road"
+
+@return     Mode, -1 if unknown
+*/
+int genMode(const char *name){
+    const char *names[] = {"random", "euclid", "cluster", "grid", "road"};
+    for (int i=0; i<5; ++i)
+        if (strcmp(name, names[i])==0)
+            return i;
+    return -1;
+}
+
+/**
+Uniform double in [0,1) from a splitmix64 stream
+*/
+inline double uniform01(unsigned long long &state){
+    return (splitmix64(state)>>11)*(1.0/9007199254740992.0);
+}
+
+/**
+Fills a full symmetric cost matrix with uniform random weights from 1 to 100, doubled above 80 (zero diagonal)
+
+@param  cost_matrix: Pointer to numNodes*numNodes integers to be written
+@param  numNodes: Number of travelling-nodes in the problem
+@param  seed: Instance seed
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+*/
+void genUniformMatrix(int *cost_matrix, int numNodes, unsigned long long seed, int numThreads){
+    // upper triangle, one stream per row
+    parallel_for(numThreads, 0, numNodes, [&](int j){
+        int i,rnd_val;
+        unsigned long long state = streamState(seed, j);
+        cost_matrix[(size_t)j*numNodes+j] = 0;
+        for (i=j+1; i<numNodes; ++i){
+            rnd_val = (splitmix64(state)>>32)%100+1; // 1 to 100
+            if (rnd_val > 80)
+                rnd_val = rnd_val*2;
+            cost_matrix[(size_t)j*numNodes+i] = rnd_val;
+        }
+    });
+    // mirror into the lower triangle
+    parallel_for(numThreads, 0, numNodes, [&](int j){
+        for (int i=0; i<j; ++i)
+            cost_matrix[(size_t)j*numNodes+i] = cost_matrix[(size_t)i*numNodes+j];
+    });
+}
+
+/**
+Draws the points of a geometric instance family
+
+@param  mode: GEN_EUCLID, GEN_CLUSTER, GEN_GRID or GEN_ROAD
+@param  xs: Pointer to numNodes x coordinates to be written
+@param  ys: Pointer to numNodes y coordinates to be written
+@param  numNodes: Number of travelling-nodes in the problem
+@param  seed: Instance seed
+*/
+void genPoints(int mode, double *xs, double *ys, int numNodes, unsigned long long seed){
+    int i,c,numClusters,side,*label;
+    double size,sigma,r,theta,*cx,*cy;
+    unsigned long long state;
+
+    size = GENSPACING*sqrt((double)numNodes);
+
+    if (mode == GEN_GRID){
+        // lattice positions, then random labels (otherwise the identity permutation would already be optimal)
+        side = ceil(sqrt((double)numNodes));
+        label = new int[numNodes];
+        for (i=0; i<numNodes; ++i)
+            label[i] = i;
+        state = streamState(seed, 0);
+        for (i=numNodes-1; i>0; --i)
+            swap(label[i], label[splitmix64(state)%(i+1)]);
+        for (i=0; i<numNodes; ++i){
+            xs[label[i]] = (i%side)*GENSPACING;
+            ys[label[i]] = (i/side)*GENSPACING;
+        }
+        delete[] label;
+        return;
+    }
+
+    if (mode == GEN_CLUSTER){
+        numClusters = max(1, numNodes/CLUSTERSIZE);
+        sigma = size/(4*sqrt((double)numClusters));
+        cx = new double[numClusters];
+        cy = new double[numClusters];
+        for (c=0; c<numClusters; ++c){
+            state = streamState(seed, numNodes+c);
+            cx[c] = uniform01(state)*size;
+            cy[c] = uniform01(state)*size;
+        }
+        for (i=0; i<numNodes; ++i){
+            state = streamState(seed, i);
+            c = splitmix64(state)%numClusters;
+            // Box-Muller
+            r = sigma*sqrt(-2*log(1-uniform01(state)));
+            theta = 2*M_PI*uniform01(state);
+            xs[i] = cx[c]+r*cos(theta);
+            ys[i] = cy[c]+r*sin(theta);
+        }
+        delete[] cx;
+        delete[] cy;
+        return;
+    }
+
+    // GEN_EUCLID, GEN_ROAD
+    for (i=0; i<numNodes; ++i){
+        state = streamState(seed, i);
+        xs[i] = uniform01(state)*size;
+        ys[i] = uniform01(state)*size;
+    }
+}
+
+/**
+Fills a full symmetric cost matrix from the points of a geometric instance family
+
+@param  mode: GEN_EUCLID, GEN_CLUSTER, GEN_GRID (rounded Euclidean) or GEN_ROAD (stretched Manhattan)
+@param  cost_matrix: Pointer to numNodes*numNodes integers to be written
+@param  xs: Pointer to the x coordinates
+@param  ys: Pointer to the y coordinates
+@param  numNodes: Number of travelling-nodes in the problem
+@param  seed: Instance seed (road detours)
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+*/
+void pointsToMatrix(int mode, int *cost_matrix, const double *xs, const double *ys, int numNodes, unsigned long long seed, int numThreads){
+    parallel_for(numThreads, 0, numNodes, [&](int j){
+        double dx,dy,detour;
+        unsigned long long state;
+        for (int i=0; i<numNodes; ++i){
+            dx = xs[i]-xs[j];
+            dy = ys[i]-ys[j];
+            if (mode == GEN_ROAD){
+                // same detour for (i,j) and (j,i): the stream depends on the unordered pair only
+                state = seed^((unsigned long long)min(i,j)<<32|(unsigned)max(i,j));
+                detour = 1+ROADDETOUR*uniform01(state);
+                cost_matrix[(size_t)j*numNodes+i] = (int)(detour*(fabs(dx)+fabs(dy))+0.5);
+            }
+            else
+                cost_matrix[(size_t)j*numNodes+i] = (int)(sqrt(dx*dx+dy*dy)+0.5);
+        }
+    });
+}
+
+/**
+Generates an instance of the given family
+
+@param  mode: Generator mode (GEN_*)
+@param  cost_matrix: Pointer to numNodes*numNodes integers to be written
+@param  numNodes: Number of travelling-nodes in the problem
+@param  seed: Instance seed
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+@param  xs: Pointer to numNodes x coordinates to be written (geometric families only, may be NULL)
+@param  ys: Pointer to numNodes y coordinates to be written (geometric families only, may be NULL)
+*/
+void genInstance(int mode, int *cost_matrix, int numNodes, unsigned long long seed, int numThreads, double *xs=NULL, double *ys=NULL){
+    bool ownPoints;
+    if (mode == GEN_RANDOM){
+        genUniformMatrix(cost_matrix, numNodes, seed, numThreads);
+        return;
+    }
+    ownPoints = xs==NULL || ys==NULL;
+    if (ownPoints){
+        xs = new double[numNodes];
+        ys = new double[numNodes];
+    }
+    genPoints(mode, xs, ys, numNodes, seed);
+    pointsToMatrix(mode, cost_matrix, xs, ys, numNodes, seed, numThreads);
+    if (ownPoints){
+        delete[] xs;
+        delete[] ys;
+    }
+}
+
+#endif
@@ -0,0 +1,433 @@
+/**
+genetic_engine.h
+Purpose: Genetic alghorithm main loop shared by every gen_tsp executable (sequential/openMP and MPI, total and detailed);
+    message exchange is compiled in only when mpi.h has been included before this header
+
+@author Danilo Franco
+*/
+
+#ifndef GENETIC_ENGINE_H
+#define GENETIC_ENGINE_H
+
+#include <chrono>
+
+#include "genetic_utils.h"
+#include "pipeline_utils.h"
+#include "bound_utils.h"
+#include "exact_utils.h"
+#include "decomposition.h"
+#include "warm_start.h"
+#include "cost_updates.h"
+
+#ifndef AVGELEMS
+#define AVGELEMS 5      // number of elements from which the average for early-stopping is computed
+#endif
+
+#if defined(MPI_VERSION) && !defined(TRANSFERRATE)
+#define TRANSFERRATE 10 // how many iterations there are between message exchanging phases
+#endif
+
+#define FIRSTOPTION 10     // index of the first optional "--name value" argument (after the 9 positional ones)
+
+double gapLimit = -1;       // stop once the best tour is within gapLimit percent from the lower bound (-1: never)
+long long lowerBound = 0;   // Held-Karp lower bound of the instance (computed only when gapLimit is set)
+bool exactSmall = true;     // whether instances up to EXACTBB nodes are solved exactly instead
+long long targetCost = -1;  // stop once the best tour costs at most targetCost (-1: never)
+double timeLimit = -1;      // stop after timeLimit seconds of a single-node run (-1: never)
+bool clusterSolve = false;  // genetic_tsp is solving the clusters of a decomposition (sub-matrices: no cost updates)
+
+#ifdef DETAILEDCOSTS
+FILE *generationFile, *transferFile, *pipelineFile;
+#endif
+
+/**
+Reads the optional engine settings from the command line:
+    --backend omp|ws   parallel backend of the generation, evaluation and sorting phases (default omp)
+    --hugepages none|thp|hugetlb   pages backing the cost matrix and the permutation matrices (default none)
+    --pipeline barrier|overlap   pipelined generations on openMP threads, with or without barriers between phases
+        (not with --backend ws)
+    --gap g   stop as soon as the best tour is within g percent from the Held-Karp lower bound
+    --target c   stop as soon as the best tour costs at most c
+    --time-limit s   stop after s seconds (ignored when more MPI nodes work together, they would lose their exchanges)
+    --exact auto|off   solve instances up to EXACTBB nodes exactly (default auto) or always run the genetic algorithm
+    --crossover half|gpx   recombination operator: first half of a parent and the rest in order (default) or gpx
+    --decompose k   split the instance in k clusters solved separately by the genetic algorithm and stitched together
+        (decomposition.h; not with --engine ils|sa)
+    --cost-feed file   apply the edge cost updates appended to file (or written to a named pipe) between generations
+        (not with --decompose)
+
+@param  argc: Number of command line arguments
+@param  argv: Command line arguments
+
+@return     False if an option has an invalid value
+*/
+bool setEngineOptions(int argc, char *argv[]){
+    const char *val;
+
+    val = getOption(argc, argv, FIRSTOPTION, "--backend");
+    if (val!=NULL && !setParallelBackend(val))
+        return false;
+
+    val = getOption(argc, argv, FIRSTOPTION, "--hugepages");
+    if (val!=NULL && !setHugePages(val))
+        return false;
+
+    val = getOption(argc, argv, FIRSTOPTION, "--pipeline");
+    if (val!=NULL && !setPipelineMode(val))
+        return false;
+    if (pipelineMode!=PIPELINE_OFF && parallelBackend!=BACKEND_OPENMP)   // the pipeline runs on openMP threads only
+        return false;
+
+    val = getOption(argc, argv, FIRSTOPTION, "--crossover");
+    if (val!=NULL && !setCrossover(val))
+        return false;
+
+    val = getOption(argc, argv, FIRSTOPTION, "--exact");
+    if (val != NULL){
+        if (strcmp(val, "auto")!=0 && strcmp(val, "off")!=0)
+            return false;
+        exactSmall = strcmp(val, "auto")==0;
+    }
+
+    val = getOption(argc, argv, FIRSTOPTION, "--decompose");
+    if (val != NULL){
+        decomposeClusters = atoi(val);
+        if (decomposeClusters < 1)
+            return false;
+    }
+
+    val = getOption(argc, argv, FIRSTOPTION, "--cost-feed");
+    if (val!=NULL && !openCostFeed(val))
+        return false;
+
+    val = getOption(argc, argv, FIRSTOPTION, "--gap");
+    if (val != NULL){
+        gapLimit = atof(val);
+        if (gapLimit < 0)
+            return false;
+    }
+
+    val = getOption(argc, argv, FIRSTOPTION, "--target");
+    if (val != NULL){
+        targetCost = atoll(val);
+        if (targetCost < 0)
+            return false;
+    }
+
+    val = getOption(argc, argv, FIRSTOPTION, "--time-limit");
+    if (val != NULL){
+        timeLimit = atof(val);
+        if (timeLimit <= 0)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+Distance of a tour cost from the lower bound
+
+@param  cost: Tour cost
+
+@return     Gap in percent of the lower bound
+*/
+double optimalityGap(int cost){
+    return 100.0*(cost-lowerBound)/max(lowerBound, 1LL);
+}
+
+/**
+Whether a tour is good enough to stop: within gapLimit from the lower bound or not costlier than targetCost
+
+@param  cost: Tour cost
+*/
+bool targetReached(long long cost){
+    return (gapLimit>=0 && optimalityGap(cost)<=gapLimit) || (targetCost>=0 && cost<=targetCost);
+}
+
+/**
+Finds and returns the solution for the tsp
+
+@param  me: Index of the current executing node in the cluster (0 when not running under MPI)
+@param  numInstances: Amount of nodes currently working on finding the solution (1 when not running under MPI)
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  population: Number of the nodes permutation (possible solution) found at each round
+@param  top: percentage [0-1] of elements from population that are going to generate new permutation
+@param  maxIt: number of max generation rounds
+@param  mutatProb: probability [0-1] of mutation occurrence in the newly generated population element
+@param  earlyStopRounds: number of latest iterations from which the average of best AVGELEMS must be computed
+            in order to establish convergence
+@param  earlyStopParam: Comparison parameter for early stopping
+
+@return     Pointer to the found nodes permutation (integer index) + solution cost + convergence boolean + iterations count
+            (small instances are solved exactly: converged, 0 iterations)
+*/
+int* genetic_tsp(int me, int numInstances, int numThreads, int *cost_matrix, int numNodes, int population, double top, int maxIt, double mutatProb, int earlyStopRounds, double earlyStopParam){
+    int countIt, i, j, best_num, probCentile, clusters, lastUpdate, changed, *solution;
+    bool reachedTarget, updatable;
+    long long target;
+    double gap;
+    double avg, *lastRounds;
+    const int *bestCosts;
+    Population *pop;
+    Pipeline *pipe;
+    vector<EdgeUpdate> updates;
+    chrono::high_resolution_clock::time_point t_start, t_end, t_run;
+    chrono::duration<double> exec_time;
+
+    t_run = chrono::high_resolution_clock::now();
+    countIt = 0;
+    best_num = population*top;
+    probCentile = mutatProb*100;
+
+    // DECOMPOSITION of large instances: the clusters are solved by plain genetic_tsp calls, without gap or target stop
+    // (nor cost updates, which refer to the whole matrix)
+    if (decomposeClusters > 1){
+        clusters = decomposeClusters;
+        gap = gapLimit;
+        target = targetCost;
+        decomposeClusters = 0;
+        gapLimit = -1;
+        targetCost = -1;
+        clusterSolve = true;
+        solution = decomposed_tsp(me, numInstances, numThreads, cost_matrix, numNodes, clusters, population, top, maxIt, mutatProb, earlyStopRounds, earlyStopParam);
+        decomposeClusters = clusters;
+        gapLimit = gap;
+        targetCost = target;
+        clusterSolve = false;
+        if (gapLimit >= 0)
+            lowerBound = heldKarpBound(cost_matrix, numNodes, numThreads);
+        return solution;
+    }
+
+    solution = new int[numNodes+3];
+    updatable = !clusterSolve;      // cost updates refer to the whole matrix, never to a cluster
+
+    // EXACT FAST PATH for small instances (same result on every node, no message exchange needed)
+    if (exactSmall && numNodes<=EXACTBB){
+        solution[numNodes] = exact_tsp(cost_matrix, numNodes, solution);
+        if (solution[numNodes] >= 0){
+#ifdef PRINTSCOST
+            printf("Solved exactly\n");
+#endif
+            solution[numNodes+1] = 1; //optimal
+            solution[numNodes+2] = countIt;
+            if (gapLimit >= 0)
+                lowerBound = solution[numNodes];
+            return solution;
+        }
+    }
+
+    lastRounds = new double[earlyStopRounds];
+    pop = newPopulation(population, numNodes);
+
+    // SEQUENTIAL INITIALISATION && RANDOM SHUFFLE (over a single row)
+    for (i=0; i<population; ++i){
+        for (j=0; j<numNodes; ++j)
+            row(pop, i)[j] = j;
+        random_shuffle(row(pop, i), row(pop, i)+numNodes, myRand);
+    }
+
+    // WARM START from prior tours of the instance (and perturbed variants of them)
+    warmStartPopulation(pop);
+
+    // LOWER BOUND for the gap-based early stop
+    if (gapLimit >= 0){
+        t_start = chrono::high_resolution_clock::now();
+        lowerBound = heldKarpBound(cost_matrix, numNodes, numThreads);
+        t_end = chrono::high_resolution_clock::now();
+        exec_time = t_end-t_start;
+#ifdef PRINTSCOST
+        printf("lower bound %lld: %f\n",lowerBound,exec_time.count());
+#endif
+    }
+
+    // FIRST RANKING
+    rank_generation(pop, cost_matrix, best_num, numThreads);
+
+    solution[numNodes+1] = 0; //not converged
+
+    if (population==best_num){
+#ifdef PRINTSCOST
+        printf("Cannot generate anymore: no space in the population for new generations\n");
+#endif
+        copy(row(pop, 0), row(pop, 0)+numNodes, solution);
+        solution[numNodes] = pop->cost[0];
+        solution[numNodes+2] = countIt;
+        delete[] lastRounds;
+        deletePopulation(pop);
+        return solution;
+    }
+
+    pipe = pipelineMode!=PIPELINE_OFF ? newPipeline(pop, best_num, numThreads) : NULL;
+    lastUpdate = 0;
+
+    // COST UPDATES: new edge costs in the matrix and in the parents, early stop rounds counted again from here
+    auto updateCosts = [&](){
+        t_start = chrono::high_resolution_clock::now();
+        if (pipe != NULL)
+            pipeline_flush(pipe, pop, best_num);
+        changed = applyCostUpdates(updates, cost_matrix, pop, best_num, numThreads);
+        if (pipe != NULL)
+            pipeline_resume(pipe, pop, best_num);
+        lastUpdate = i-1;
+        if (gapLimit >= 0)
+            lowerBound = heldKarpBound(cost_matrix, numNodes, numThreads);
+        t_end = chrono::high_resolution_clock::now();
+        exec_time = t_end-t_start;
+#ifdef PRINTSCOST
+        printf("\tcost updates: %d edges, %d parents changed: %f\n\t-------------\n",(int)updates.size(),changed,exec_time.count());
+#endif
+    };
+
+    // GENERATION ITERATION
+    for(i=1; i<=maxIt; ++i){
+#if defined(PRINTSCOST) || defined(PRINTSMAT)
+        printf("#%d\n",i);
+#endif
+
+#ifdef PRINTSMAT
+        printMatrix(pop->generation,population,numNodes,pop->stride);
+        printMatrix(pop->cost,1,population);
+        printMatrix(pop->age,1,population);
+#endif
+
+        ++countIt;
+#ifdef MPI_VERSION
+        solution[numNodes+1] = 0;
+#endif
+
+        // COST UPDATES between generations (with more MPI nodes at the exchanges, see below)
+        if (updatable && dynamicCosts && numInstances==1 && takeCostUpdates(updates))
+            updateCosts();
+
+        if (pipe != NULL){
+            // GENERATE, RANK AND MOVE ON TOP IN ONE PIPELINED STEP
+            t_start = chrono::high_resolution_clock::now();
+            pipelined_generation(pipe, pop, cost_matrix, best_num, probCentile);
+            t_end = chrono::high_resolution_clock::now();
+            exec_time = t_end-t_start;
+#ifdef PRINTSCOST
+            printf("\tpipelined generation & ranking: %f\n",exec_time.count());
+            for(j=0; j<numThreads; ++j)
+                printf("\t\tthread %d: work %f, idle %f\n",j,pipe->work[j],pipe->idle[j]);
+            printf("\t-------------\n");
+#endif
+#ifdef DETAILEDCOSTS
+            for(j=0; j<numThreads; ++j)
+                asyncPrintf(pipelineFile,"%d %d %d %d %f %f\n",numNodes,population,best_num,j,pipe->work[j],pipe->idle[j]);
+#endif
+        }
+        else {
+            // GENERATE NEW POPULATION WITH MUTATION
+            t_start = chrono::high_resolution_clock::now();
+            generate(pop, cost_matrix, best_num, probCentile, numThreads);
+            t_end = chrono::high_resolution_clock::now();
+            exec_time=t_end-t_start;
+#ifdef PRINTSCOST
+            printf("\tgeneration: %f\n\t-------------\n",exec_time.count());
+#endif
+#ifdef DETAILEDCOSTS
+            asyncPrintf(generationFile,"%d %d %d %f\n",numNodes,population,best_num,exec_time.count());
+#endif
+
+            // RANKING
+            t_start = chrono::high_resolution_clock::now();
+            rank_generation(pop, cost_matrix, best_num, numThreads);
+            t_end = chrono::high_resolution_clock::now();
+            exec_time = t_end-t_start;
+#ifdef PRINTSCOST
+            printf("\tranking: %f\n\t-------------\n",exec_time.count());
+#endif
+        }
+
+        // compute average of best #AVGELEMS costs
+        bestCosts = pipe!=NULL ? pipeline_best(pipe, pop, best_num, AVGELEMS) : pop->cost;
+        avg = 0;
+        for(j=0; j<AVGELEMS; ++j){
+            avg += bestCosts[j];
+        }
+        lastRounds[(i-1)%earlyStopRounds] = avg/AVGELEMS;
+        reachedTarget = targetReached(bestCosts[0]);
+#ifdef PRINTSCOST
+        printf("\tbest %d average travelling cost: %f\n",AVGELEMS,lastRounds[(i-1)%earlyStopRounds]);
+        printf("\tbest %d standard deviation: %f\n",AVGELEMS,stdDev(lastRounds, earlyStopRounds));
+        if (gapLimit >= 0)
+            printf("\tgap from the lower bound: %f%%\n",optimalityGap(bestCosts[0]));
+        if (pipe != NULL)
+            printf("\tbest age: %d, distinct parents: %d\n\t-------------\n",pop->age[pipe->best[0]],pipeline_distinct(pipe, pop, best_num));
+        else
+            printf("\tbest age: %d, distinct parents: %d\n\t-------------\n",pop->age[0],countDistinct(pop->hash, best_num));
+#endif
+
+#ifdef MPI_VERSION
+        // EXCHANGE BEST WITH OTHER NODES
+        if(numInstances>1 && i!=maxIt && !(i%TRANSFERRATE)){
+            t_start = chrono::high_resolution_clock::now();
+            if (pipe != NULL)
+                pipeline_flush(pipe, pop, best_num);
+            // the batch of node 0 on every node, so that they keep the same matrix (always broadcast, even if empty:
+            // updates may be queued on node 0 only)
+            if (me==0 && dynamicCosts)
+                takeCostUpdates(updates);
+            else
+                updates.clear();
+            bcastCostUpdates(updates);
+            if (!updates.empty())
+                updateCosts();
+            transferReceive_bests_allReduce(pop, best_num);
+            if (pipe != NULL)
+                pipeline_resume(pipe, pop, best_num);
+            t_end = chrono::high_resolution_clock::now();
+            exec_time = t_end-t_start;
+#ifdef PRINTSCOST
+            printf("\tmessage passing: %f\n\t-------------\n",exec_time.count());
+#endif
+#ifdef DETAILEDCOSTS
+            asyncPrintf(transferFile,"%d %d %d %f\n",numNodes,population,best_num,exec_time.count());
+#endif
+            continue;
+        }
+#endif
+
+        // TIME LIMIT (not converged)
+        exec_time = chrono::high_resolution_clock::now()-t_run;
+        if (timeLimit>=0 && numInstances==1 && exec_time.count()>=timeLimit)
+            break;
+
+        // TEST EARLY STOP (with short-circuit to ensure that lastRounds is filled before computing the stdDev over it)
+        if(reachedTarget || (i-lastUpdate>=earlyStopRounds && stdDev(lastRounds, earlyStopRounds)<=earlyStopParam)){
+#ifdef PRINTSCOST
+            printf("\n\t\tEarly stop!\n\n");
+#endif
+            solution[numNodes+1] = 1; //converged
+#ifdef MPI_VERSION
+            // move to next exchange session (hoping that can help moving out from a fake convergence)
+            // ... moreover other nodes might continue to expect messages
+            if (numInstances > 1){
+                if(i<maxIt-TRANSFERRATE){
+                    i += TRANSFERRATE-(i%TRANSFERRATE)-1;
+                }
+                continue;
+            }
+#endif
+            break;
+        }
+    }
+
+    if (pipe != NULL){
+        pipeline_flush(pipe, pop, best_num);
+        deletePipeline(pipe);
+    }
+    copy(row(pop, 0), row(pop, 0)+numNodes, solution);
+    solution[numNodes] = pop->cost[0];
+    solution[numNodes+2] = countIt;
+
+    delete[] lastRounds;
+    deletePopulation(pop);
+
+    return solution;
+}
+
+#endif
@@ -5,14 +5,37 @@ Purpose: Utility functions for gen_tsp.cpp
 @author Danilo Franco
 */
 
-#include <set>          // collection of distinct elements (used in the generation of a new permutation - nodes unicity)
+#ifndef GENETIC_UTILS_H
+#define GENETIC_UTILS_H
+
+#include <vector>
 #include <cmath>        // rand
 #include <algorithm>    // random_shuffle, copy, fill
 
+#include "rng_utils.h"
+#include "async_writer.h"
+#include "parallel_backend.h"
 #include "sorting_utils.h"
+#include "population.h"
+#include "evaluation_utils.h"
+#include "simd_utils.h"
+#include "gpx_utils.h"
 
 //#define PRINTSCOST      // wheter to print temporal costs for the ranking phase
 
+#define CROSSOVER_HALF 0
+#define CROSSOVER_GPX 1
+
+#ifndef GPXELITE
+#define GPXELITE 10     // percentage of the parents (the best ones) whose matings use the gpx operator
+#endif
+
+int crossoverOperator = CROSSOVER_HALF;
+
+#ifdef DETAILEDRANKCOSTS
+FILE *pathComputationFile, *sortingFile, *rearrangeFile;
+#endif
+
 /**
 Random number generator for the std::random_shuffle method of <algorithm>
 
@@ -21,7 +44,7 @@ Random number generator for the std::random_shuffle method of <algorithm>
 @return Swap element index
 */
 int myRand(int i){
-    return rand()%i;
+    return randomBelow(i);
 }
 
 /**
@@ -47,59 +70,79 @@ double stdDev(double *array, int len){
 }
 
 /**
-Sort an array and apply the same operation to an index array in order to keep track of the sorted row positions
+Sort an array and apply the same operation to an index array in order to keep track of the sorted row positions;
+    the first elements may already be sorted, in which case only the remaining ones are sorted and then merged with them
 
-@version 3.0 (parallel mergesort)
+@version 4.0 (parallel mergesort of the unsorted part + linear merge)
 @param  generation_rank: Index array
 @param  generation_cost: Sorting array
 @param  population: Array length 
+@param  sorted: Number of leading elements that are already sorted
 @param  numThreads: Number of processing elements that are due to work on each parallel section
 */
-void sort_vector(int *generation_rank, int *generation_cost, int population, int numThreads){
-    int low,high;
-    low=0;
+void sort_vector(int *generation_rank, int *generation_cost, int population, int sorted, int numThreads){
+    int low,high,*temp;
+    low=sorted;
     high=population-1;
     
-    #pragma omp parallel num_threads(numThreads)
-    #pragma omp single
-    mergesort(generation_cost, generation_rank, low, high, numThreads);
+    if (low < high)
+        parallel_region(numThreads, [&](){
+            mergesort(generation_cost, generation_rank, low, high, numThreads);
+        });
     //quickSort(generation_rank, generation_cost, low, high);
+
+    if (sorted > 0 && sorted < population){
+        temp = new int[population*2];
+        merge(generation_cost, generation_rank, temp, 0, sorted-1, high);
+        delete[] temp;
+    }
 }
 
 /**
-Move rows in the generation matrix according to the sorted index array
+Move rows in the generation matrix according to the sorted index array, together with their hash and age
+    (the cost array is already sorted)
 
 @param  generation_rank: Pointer to the index array
-@param  generation: Pointer to the permutation matrix (population*nodes) for the current iteration
-@param  generation_copy: Pointer to the auxiliary permutation matrix (temporarily holds the sorted generation)
-@param  numNodes: Number of travelling-nodes in the problem
+@param  pop: Population whose best rows are moved on top
 @param  bestNum: Number of best elements (parents) that will produce the next generation
+@param  ageStep: Age increase of the moved rows (0 when they have already been counted as parents)
 */
-void move_top(int *generation_rank, int *&generation, int *&generation_copy, int numNodes, int bestNum){
-    int i,*start,*swap;
+void move_top(int *generation_rank, Population *pop, int bestNum, int ageStep=1){
+    int i,*start,*swap,*swapAge;
+    unsigned long long *swapHash;
     for(i=0; i<bestNum; ++i){
-        start = generation+generation_rank[i]*numNodes;
-        copy(start, start+numNodes, generation_copy+i*numNodes);
+        start = row(pop, generation_rank[i]);
+        copy(start, start+pop->numNodes, pop->generation_copy+(size_t)i*pop->stride);
+        pop->hash_copy[i] = pop->hash[generation_rank[i]];
+        pop->age_copy[i] = pop->age[generation_rank[i]]+ageStep;
     }
-    swap = generation;
-    generation = generation_copy;
-    generation_copy = swap;
+    swap = pop->generation;
+    pop->generation = pop->generation_copy;
+    pop->generation_copy = swap;
+    swapHash = pop->hash;
+    pop->hash = pop->hash_copy;
+    pop->hash_copy = swapHash;
+    swapAge = pop->age;
+    pop->age = pop->age_copy;
+    pop->age_copy = swapAge;
+    pop->ranked = bestNum;
 }
 
 /**
-Compute the permutation cost for the current generation and rank them
+Compute the permutation cost (and hash) for the current generation and rank them: the rows already ranked (the parents
+    moved on top by the previous call) keep their cost and are only merged with the newly evaluated ones
 
-@param  generation_cost: Pointer to the total permutation cost array
-@param  generation: Pointer to the permutation matrix (population*nodes) for the current iteration
-@param  generation_copy: Pointer to the copied permutation matrix
+@param  pop: Population to be ranked
 @param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
-@param  numNodes: Number of travelling-nodes in the problem
-@param  population: Number of the nodes permutation (possible solution) found at each round
 @param  bestNum: Number of best elements that will produce the next generation
 @param  numThreads: Number of processing elements that are due to work on each parallel section
 */
-void rank_generation(int *generation_cost, int *&generation, int *&generation_copy, int *cost_matrix, int numNodes, int population, int bestNum, int numThreads){
-    int i,j,source,destination,*generation_rank;
+void rank_generation(Population *pop, int *cost_matrix, int bestNum, int numThreads){
+    int population,ranked,*generation_cost,*generation_rank;
+
+    population = pop->size;
+    ranked = pop->ranked;
+    generation_cost = pop->cost;
 
     chrono::high_resolution_clock::time_point t_start, t_end;
     chrono::duration<double> exec_time;
@@ -109,124 +152,186 @@ void rank_generation(int *generation_cost, int *&generation, int *&generation_co
     t_start = chrono::high_resolution_clock::now();
 
     // COST VECTOR COMPUTATION & RANK INITIALISATION
-    fill(generation_cost, generation_cost+population, 0);
-#pragma omp parallel for num_threads(numThreads) private(source,destination,i,j) schedule(static)
-    for(i=0; i<population; ++i){
-        // cost of last node linked to the first one
-        source = generation[i*numNodes+numNodes-1];
-        destination = generation[i*numNodes];
-        generation_cost[i] += cost_matrix[source*numNodes+destination];
-        // cost of adjacent cells
-        for(j=0; j<numNodes-1; ++j){
-            source = destination;
-            destination = generation[i*numNodes+j+1];
-            generation_cost[i] += cost_matrix[source*numNodes+destination];
-        }
-        
+    evaluate_rows(pop, cost_matrix, ranked, population-ranked, numThreads);
+    for(int i=0; i<population; ++i)
         generation_rank[i]=i;
-    }
 
     t_end = chrono::high_resolution_clock::now();
     exec_time=t_end-t_start;
     #ifdef PRINTSCOST
         printf("\t\tinitialisation & paths costs computation: %f\n",exec_time.count());
     #endif
+    #ifdef DETAILEDRANKCOSTS
+        asyncPrintf(pathComputationFile,"%d %d %d %f\n",pop->numNodes,population,bestNum,exec_time.count());
+    #endif
 
     t_start = chrono::high_resolution_clock::now();
-    sort_vector(generation_rank, generation_cost, population, numThreads);
+    sort_vector(generation_rank, generation_cost, population, ranked, numThreads);
     t_end = chrono::high_resolution_clock::now();
     exec_time=t_end-t_start;
     #ifdef PRINTSCOST
         printf("\t\tsorting: %f\n",exec_time.count());
     #endif
+    #ifdef DETAILEDRANKCOSTS
+        asyncPrintf(sortingFile,"%d %d %d %f\n",pop->numNodes,population,bestNum,exec_time.count());
+    #endif
 
     //MOVE BEST ROWS TO TOP
     t_start = chrono::high_resolution_clock::now();
-    move_top(generation_rank, generation, generation_copy, numNodes, bestNum);
+    move_top(generation_rank, pop, bestNum);
     t_end = chrono::high_resolution_clock::now();
     exec_time=t_end-t_start;
     #ifdef PRINTSCOST
         printf("\t\tmatrix rearranging: %f\n",exec_time.count());
     #endif
+    #ifdef DETAILEDRANKCOSTS
+        asyncPrintf(rearrangeFile,"%d %d %d %f\n",pop->numNodes,population,bestNum,exec_time.count());
+    #endif
 
-    delete generation_rank;
+    delete[] generation_rank;
     return;
 }
 
+/**
+Sets the crossover operator from its command line name
+
+@param  name: "half" (first half from a parent, the rest in the order of the other) or "gpx"
+
+@return     True iff the name is a known operator
+*/
+bool setCrossover(const char *name){
+    if (strcmp(name, "half")==0)
+        crossoverOperator = CROSSOVER_HALF;
+    else if (strcmp(name, "gpx")==0)
+        crossoverOperator = CROSSOVER_GPX;
+    else
+        return false;
+    return true;
+}
+
+/**
+Mutation: swap between two random nodes, with the given probability
+
+@param  son: Pointer to the row to be mutated
+@param  numNodes: Number of travelling-nodes in the problem
+@param  probCentile: probability [0-100] of mutation occurence
+*/
+inline void mutation(int *son, int numNodes, int probCentile){
+    int swap1,swap2,elem;
+    if((int)randomBelow(100)+1<=probCentile){
+        swap1=randomBelow(numNodes);
+        do {
+            swap2=randomBelow(numNodes);
+        } while(swap2==swap1);
+
+        elem = son[swap1];
+        son[swap1] = son[swap2];
+        son[swap2] = elem;
+    }
+}
+
 /**
 Generates new permutation from two parents: first half from parent1 and all the remaining from parent2 (in order as well) +
     + mutation: swap between two random nodes
 
-@param  generation: Pointer to the permutation matrix (population*nodes) for the current iteration
-@param  parent1: index referring to a row in the generation matrix (read)
-@param  parent2: index referring to a row in the generation matrix (read)
-@param  son: index referring to a row in the generation matrix (write)
+@version 2.0 (taken nodes in a per-thread bitmap, parent2 filtered with the vector compaction of simd_utils.h)
+@param  parent1: Pointer to the first parent row (read)
+@param  parent2: Pointer to the second parent row (read)
+@param  son: Pointer to the row to be generated (write)
 @param  numNodes: Number of travelling-nodes in the problem
 @param  probCentile: probability [0-100] of mutation occurence in the newly generated population element
 */
-void crossover_firstHalf_withMutation(int *generation, int parent1, int parent2, int son, int numNodes, int probCentile){
-    set<int> nodes;
-    int j,k,half,elem,swap1,swap2;
+void crossover_firstHalf_withMutation(const int *parent1, const int *parent2, int *son, int numNodes, int probCentile){
+    static thread_local vector<unsigned> takenBits;
+    unsigned *taken;
+    int j,half,elem,words;
 
     half = floor(numNodes/2);
+    words = (numNodes+31)/32;
+    if ((int)takenBits.size() < words)
+        takenBits.resize(words);
+    taken = takenBits.data();
+    fill(taken, taken+words, 0);
 
     // take first half from parent1
     for(j=0; j<half; ++j){
-        elem = generation[parent1*numNodes+j];
-        generation[son+j] = elem;
-        nodes.insert(elem);
+        elem = parent1[j];
+        son[j] = elem;
+        setBit(taken, elem);
     }
     // add the remaining elements from parent2
-    for(k=0; k<numNodes; ++k){
-        elem = generation[parent2*numNodes+k];
-        if(nodes.find(elem)==nodes.end()){
-            generation[son+j] = elem;
-            ++j;
-        }
-    }
-    // MUTATION
-    if((rand()%100+1)<=probCentile){
-        swap1=rand()%numNodes;
-        do {
-            swap2=rand()%numNodes;
-        } while(swap2==swap1);
+    compact_untaken(parent2, numNodes, taken, son+half, numNodes-half);
 
-        elem = generation[son+swap1];
-        generation[son+swap1] = generation[son+swap2];
-        generation[son+swap2] = elem;
-    }
+    mutation(son, numNodes, probCentile);
     return;
 }
 
+/**
+Generates new permutation with the generalized partition crossover of gpx_utils.h + mutation; parents without any
+    component to recombine (e.g. equal ones) fall back to the fixed-half crossover
+
+@param  parent1: Pointer to the first parent row (read)
+@param  parent2: Pointer to the second parent row (read)
+@param  son: Pointer to the row to be generated (write)
+@param  numNodes: Number of travelling-nodes in the problem
+@param  probCentile: probability [0-100] of mutation occurence in the newly generated population element
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+*/
+void crossover_gpx_withMutation(const int *parent1, const int *parent2, int *son, int numNodes, int probCentile, const int *cost_matrix){
+    if (!gpx_child(parent1, parent2, son, numNodes, cost_matrix)){
+        crossover_firstHalf_withMutation(parent1, parent2, son, numNodes, probCentile);
+        return;
+    }
+    mutation(son, numNodes, probCentile);
+}
+
+/**
+Generates new permutation with the selected crossover operator (gpx only between elite parents, the fixed-half
+    crossover otherwise: gpx children stay close to the better parent and would make the population collapse)
+
+@param  parent1: Pointer to the first parent row (read)
+@param  parent2: Pointer to the second parent row (read)
+@param  son: Pointer to the row to be generated (write)
+@param  numNodes: Number of travelling-nodes in the problem
+@param  probCentile: probability [0-100] of mutation occurence in the newly generated population element
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  elite: Whether both parents are among the best GPXELITE percent
+*/
+inline void crossover(const int *parent1, const int *parent2, int *son, int numNodes, int probCentile, const int *cost_matrix, bool elite){
+    if (crossoverOperator==CROSSOVER_GPX && elite)
+        crossover_gpx_withMutation(parent1, parent2, son, numNodes, probCentile, cost_matrix);
+    else
+        crossover_firstHalf_withMutation(parent1, parent2, son, numNodes, probCentile);
+}
+
 /**
 Having the sorted generation matrix, fill it from the last parent index untill the end with the chosen crossover
 
-@param  generation: Pointer to the permutation matrix (population*nodes) for the current iteration
-@param  population: Number of the nodes permutation (possible solution) found at each round
+@param  pop: Population whose rows from bestNum on are replaced by the newborns
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix (for the gpx operator)
 @param  bestNum: Number of best elements (parents) that will produce the next generation
-@param  numNodes: Number of travelling-nodes in the problem
 @param  probCentile: Probability [0-100] of mutation occurence in the newly generated population element
 @param  numThreads: Number of processing elements that are due to work on each parallel section
 */
-void generate(int *generation, int population, int bestNum, int numNodes, int probCentile, int numThreads){
-    int i,parent1,parent2,son;
-
+void generate(Population *pop, int *cost_matrix, int bestNum, int probCentile, int numThreads){
     // fill from bestnum until all population is reached
-#pragma omp parallel for num_threads(numThreads) private(parent1,parent2,son,i) schedule(static)
-    for(i=0; i<population-bestNum; ++i){
+    parallel_for(numThreads, 0, pop->size-bestNum, [&](int i){
+        int parent1,parent2,son;
         if (i<bestNum) // each best must generate at least one son
             parent1 = i;          
         else
-            parent1 = rand()%bestNum;
+            parent1 = randomBelow(bestNum);
 
         do {    // two different parents
-            parent2 = rand()%bestNum;
+            parent2 = randomBelow(bestNum);
         } while(parent2==i);
         
-        son = (bestNum+i)*numNodes;
+        son = bestNum+i;
 
-        crossover_firstHalf_withMutation(generation, parent1, parent2, son, numNodes, probCentile);    
-    }
+        crossover(row(pop, parent1), row(pop, parent2), row(pop, son), pop->numNodes, probCentile, cost_matrix,
+                  max(parent1, parent2)*100 < bestNum*GPXELITE);
+        pop->age[son] = 0;
+    });
 }
 
 /**
@@ -246,6 +351,7 @@ bool equal_permutations(int *first, int *second, int len){
     return true;
 }
 
+#ifdef MPI_VERSION   // message exchange utilities: only available when compiled against mpi.h
 /**
 Custom MPI_Op for the MPI_AllReduce: checks wheter a buffer (node permutation) of lower cost is received, if so overwrite the held one
 
@@ -265,30 +371,40 @@ void minimumCost(int *in, int *out, int *len, MPI_Datatype *dtype){
 /**
 Performs a custom MPI_Op allReduce: exchange messages with every nodes that will consequently deal with the custom MPI_Op
 
-@param  generation: Pointer to the permutation matrix (population*nodes) for the current iteration
-@param  generation_cost: pointer to the total permutation cost array
-@param  numNodes: Number of travelling-nodes in the problem
+@param  pop: Population whose last parent is replaced by the received permutation (if different from the best),
+    which is then ranked again together with the newborns
 @param  bestNum: Number of best elements (parents) that will produce the next generation
 */
-void transferReceive_bests_allReduce(int *generation, int *generation_cost, int numNodes, int bestNum){
-    int buff_size,*send_buff,*recv_buff;
+void transferReceive_bests_allReduce(Population *pop, int bestNum){
+    int numNodes,buff_size,*send_buff,*recv_buff,*generation;
     MPI_Op op;
 
+    numNodes = pop->numNodes;
+    generation = row(pop, 0);
     buff_size = numNodes+1;
     send_buff = new int[buff_size];
     recv_buff = new int[buff_size];
 
     copy(generation, generation+numNodes, send_buff);
-    send_buff[numNodes] = generation_cost[0];
+    send_buff[numNodes] = pop->cost[0];
 
     MPI_Op_create((MPI_User_function *)minimumCost, 1, &op);
 
     MPI_Allreduce(send_buff, recv_buff, buff_size, MPI_INT, op, MPI_COMM_WORLD);
 
     if (!equal_permutations(generation, recv_buff, numNodes)){
-        copy(recv_buff, recv_buff+numNodes, generation+(bestNum-1)*numNodes);
-        generation_cost[bestNum-1] = recv_buff[numNodes];
+        copy(recv_buff, recv_buff+numNodes, row(pop, bestNum-1));
+        pop->cost[bestNum-1] = recv_buff[numNodes];
+        pop->hash[bestNum-1] = tourHash(recv_buff, numNodes);
+        pop->age[bestNum-1] = 0;
+        pop->ranked = bestNum-1;
     }
 
+    MPI_Op_free(&op);
+    delete[] send_buff;
+    delete[] recv_buff;
     return;
-}
\ No newline at end of file
+}
+#endif
+
+#endif
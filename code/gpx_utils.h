@@ -0,0 +1,179 @@
+/**
+gpx_utils.h
+Purpose: Generalized partition crossover (GPX) for genetic_utils.h: the edges that are not shared by the two parents
+    split the nodes in components; every component that both parents enter and leave only once (through the same
+    shared edges) is a sub-path between the same two nodes in both tours, so the child takes the cheaper of the two
+    for each of them and the better parent everywhere else: it is never worse than either parent, in O(numNodes)
+
+@author Danilo Franco
+*/
+
+#ifndef GPX_UTILS_H
+#define GPX_UTILS_H
+
+#include <vector>
+
+/**
+Per-thread scratch buffers of the crossover (grown on demand, never shrunk)
+*/
+struct GpxScratch {
+    vector<int> nextA, prevA;       // successor and predecessor of each node in the first parent
+    vector<int> nextB, prevB;       // same in the second parent
+    vector<int> component;          // union-find parent, then component root of each node
+    vector<int> cut;                // shared edges leaving each component (at its root)
+    vector<int> size;               // nodes of each component (at its root)
+    vector<long long> gain;         // cost of parent1's sub-path minus parent2's one (at its root)
+};
+
+/**
+Root of a node in the union-find forest (with path halving)
+
+@param  component: Union-find parents
+@param  node: Node whose root is looked for
+*/
+inline int gpx_find(int *component, int node){
+    while (component[node] != node){
+        component[node] = component[component[node]];
+        node = component[node];
+    }
+    return node;
+}
+
+/**
+Builds the GPX child of two parents
+
+@param  parent1: Pointer to the first parent row (read)
+@param  parent2: Pointer to the second parent row (read)
+@param  son: Pointer to the row to be generated (write)
+@param  numNodes: Number of travelling-nodes in the problem
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+
+@return     False (son not written) if no component can be recombined
+*/
+bool gpx_child(const int *parent1, const int *parent2, int *son, int numNodes, const int *cost_matrix){
+    static thread_local GpxScratch s;
+    const int *a,*b,*swap;
+    int *comp,i,j,v,w,root,node,prev,next,len,sign,shared;
+    long long costA,costB;
+    bool improves;
+
+    if ((int)s.nextA.size() < numNodes){
+        s.nextA.resize(numNodes);
+        s.prevA.resize(numNodes);
+        s.nextB.resize(numNodes);
+        s.prevB.resize(numNodes);
+        s.component.resize(numNodes);
+        s.cut.resize(numNodes);
+        s.size.resize(numNodes);
+        s.gain.resize(numNodes);
+    }
+    comp = s.component.data();
+
+    auto cost = [&](int v, int w){ return cost_matrix[(size_t)v*numNodes+w]; };
+
+    a = parent1;
+    b = parent2;
+    for (i=0; i<numNodes; ++i){
+        j = i+1<numNodes ? i+1 : 0;
+        s.nextA[a[i]] = a[j];
+        s.prevA[a[j]] = a[i];
+        s.nextB[b[i]] = b[j];
+        s.prevB[b[j]] = b[i];
+        comp[i] = i;
+        s.cut[i] = 0;
+        s.size[i] = 0;
+        s.gain[i] = 0;
+    }
+
+    // components are cut by shared edges only: at least two are needed
+    shared = 0;
+    for (v=0; v<numNodes; ++v)
+        shared += s.nextA[v]==s.nextB[v] || s.nextA[v]==s.prevB[v];
+    if (shared < 2)
+        return false;
+
+    // COMPONENTS of the edges that are not shared
+    for (v=0; v<numNodes; ++v){
+        w = s.nextA[v];
+        if (w!=s.nextB[v] && w!=s.prevB[v])
+            comp[gpx_find(comp, v)] = gpx_find(comp, w);
+        w = s.nextB[v];
+        if (w!=s.nextA[v] && w!=s.prevA[v])
+            comp[gpx_find(comp, v)] = gpx_find(comp, w);
+    }
+    for (v=0; v<numNodes; ++v)
+        comp[v] = gpx_find(comp, v);
+
+    // CUT SIZE, SIZE AND GAIN of each component (edges between components are shared, so cut once per tour)
+    for (v=0; v<numNodes; ++v){
+        ++s.size[comp[v]];
+        w = s.nextA[v];
+        if (comp[w] != comp[v]){
+            ++s.cut[comp[v]];
+            ++s.cut[comp[w]];
+        }
+        else
+            s.gain[comp[v]] += cost(v, w);
+        w = s.nextB[v];
+        if (comp[w] == comp[v])
+            s.gain[comp[v]] -= cost(v, w);
+    }
+    improves = false;
+    for (v=0; v<numNodes; ++v)
+        if (comp[v]==v && s.cut[v]==2 && s.size[v]>1 && s.gain[v]!=0)
+            improves = true;
+    if (!improves)      // nothing to recombine
+        return false;
+
+    // the better parent is the base of the child (tour costs only computed when something can be recombined)
+    costA = costB = 0;
+    for (i=0; i<numNodes; ++i){
+        j = i+1<numNodes ? i+1 : 0;
+        costA += cost(a[i], a[j]);
+        costB += cost(b[i], b[j]);
+    }
+    sign = 1;
+    if (costB < costA){
+        swap = a;
+        a = b;
+        b = swap;
+        s.nextB.swap(s.nextA);
+        s.prevB.swap(s.prevA);
+        sign = -1;
+    }
+    improves = false;
+    for (v=0; v<numNodes; ++v)
+        if (comp[v]==v && s.cut[v]==2 && s.size[v]>1 && sign*s.gain[v]>0)
+            improves = true;
+    if (!improves)      // the child would be the better parent
+        return false;
+
+    // CHILD: the base parent from a component boundary, with the improving sub-paths of the other parent
+    for (i=0; comp[a[i]]==comp[a[i>0 ? i-1 : numNodes-1]]; ++i);
+    len = 0;
+    while (len < numNodes){
+        v = a[i];
+        root = comp[v];
+        if (s.cut[root]==2 && s.size[root]>1 && sign*s.gain[root]>0){
+            // v is where both parents enter the component: follow the second one inside it
+            prev = -1;
+            node = v;
+            for (j=0; j<s.size[root]; ++j){
+                son[len++] = node;
+                next = s.nextB[node];
+                if (next==prev || comp[next]!=root)
+                    next = s.prevB[node];
+                prev = node;
+                node = next;
+            }
+            i = (i+s.size[root])%numNodes;
+        }
+        else {
+            son[len++] = v;
+            i = i+1<numNodes ? i+1 : 0;
+        }
+    }
+    return true;
+}
+
+#endif
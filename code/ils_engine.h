@@ -0,0 +1,240 @@
+/**
+ils_engine.h
+Purpose: Iterated local search engine, alternative to the genetic algorithm of genetic_engine.h: every thread (and every
+    MPI node) runs an independent chain of double-bridge kicks, each one followed by 2-opt and Or-opt local search on
+    the nearest neighbor lists and kept only if the tour is not worse than the best one of the chain
+
+@author Danilo Franco
+*/
+
+#ifndef ILS_ENGINE_H
+#define ILS_ENGINE_H
+
+#include <vector>
+#include <chrono>
+
+#include "instance_utils.h"
+#include "genetic_engine.h"
+#include "local_search.h"
+
+#define ILSKICKS 100        // kicks of a round (convergence and gap are tested after each round)
+#define ILSSEGMENT 50       // longest segment exchanged by a double-bridge kick
+#define ILSMINNODES 8       // smaller instances are left to the genetic algorithm
+
+/**
+Result of a chain
+*/
+struct IlsChain {
+    vector<int> tour;
+    long long cost;
+    int rounds;
+    bool converged;
+};
+
+/**
+Nearest neighbour tour, following the neighbor lists while they reach an unvisited node (the whole row otherwise)
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  neighbors: Nearest neighbor lists (numNodes*numNeighbors)
+@param  numNeighbors: Length of each neighbor list
+@param  start: First node of the tour
+@param  tour: Written with the tour
+*/
+void ils_startTour(const int *cost_matrix, int numNodes, const int *neighbors, int numNeighbors, int start, int *tour){
+    vector<char> visited(numNodes, 0);
+    int i,k,current,next;
+
+    current = start;
+    visited[current] = 1;
+    tour[0] = current;
+    for (i=1; i<numNodes; ++i){
+        next = -1;
+        for (k=0; k<numNeighbors && next<0; ++k)
+            if (!visited[neighbors[(size_t)current*numNeighbors+k]])
+                next = neighbors[(size_t)current*numNeighbors+k];
+        if (next < 0)
+            for (k=0; k<numNodes; ++k)
+                if (!visited[k] && (next<0 || cost_matrix[(size_t)current*numNodes+k]<cost_matrix[(size_t)current*numNodes+next]))
+                    next = k;
+        visited[next] = 1;
+        tour[i] = next;
+        current = next;
+    }
+}
+
+/**
+Double-bridge kick on two random consecutive segments: p B C q becomes p C B q (three edges replaced)
+
+@param  lt: Local search state (the endpoints of the new edges are queued)
+*/
+void ils_kick(LocalTour &lt){
+    int n,maxLen,lenB,lenC,first,k,p,b1,bl,c1,cl,q;
+    vector<int> &tour = lt.tour;
+    int moved[2*ILSSEGMENT];
+
+    n = lt.numNodes;
+    maxLen = min(ILSSEGMENT, (n-2)/2);
+    lenB = 1+randomBelow(maxLen);
+    lenC = 1+randomBelow(maxLen);
+    first = randomBelow(n);
+    p = tour[first];
+    b1 = tour[(first+1)%n];
+    bl = tour[(first+lenB)%n];
+    c1 = tour[(first+lenB+1)%n];
+    cl = tour[(first+lenB+lenC)%n];
+    q = tour[(first+lenB+lenC+1)%n];
+
+    lt.cost += ls_cost(lt, p, c1)+ls_cost(lt, cl, b1)+ls_cost(lt, bl, q)
+              -ls_cost(lt, p, b1)-ls_cost(lt, bl, c1)-ls_cost(lt, cl, q);
+    for (k=0; k<lenC; ++k)
+        moved[k] = tour[(first+lenB+1+k)%n];
+    for (k=0; k<lenB; ++k)
+        moved[lenC+k] = tour[(first+1+k)%n];
+    for (k=0; k<lenB+lenC; ++k){
+        tour[(first+1+k)%n] = moved[k];
+        lt.pos[moved[k]] = (first+1+k)%n;
+    }
+
+    ls_push(lt, p);
+    ls_push(lt, b1);
+    ls_push(lt, bl);
+    ls_push(lt, c1);
+    ls_push(lt, cl);
+    ls_push(lt, q);
+}
+
+/**
+Runs one chain: prior tour (warm start) or nearest neighbour tour from a random node, local search, then rounds of
+    ILSKICKS kicks until the standard deviation of the best cost over the last rounds or the gap from the lower bound
+    is small enough, the target cost is reached or the time limit expires
+
+@param  chain: Written with the result of the chain
+@param  id: Index of the chain (for the traces)
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  neighbors: Nearest neighbor lists (numNodes*numNeighbors)
+@param  numNeighbors: Length of each neighbor list
+@param  maxIt: Maximum number of rounds
+@param  earlyStopRounds: Number of latest rounds whose best costs are compared to establish convergence
+@param  earlyStopParam: Comparison parameter for early stopping (standard deviation)
+*/
+void ils_chain(IlsChain &chain, int id, const int *cost_matrix, int numNodes, const int *neighbors, int numNeighbors, int maxIt, int earlyStopRounds, double earlyStopParam){
+    LocalTour lt;
+    vector<double> lastRounds(earlyStopRounds);
+    int r,k,i;
+    chrono::high_resolution_clock::time_point t_start, t_chain;
+    chrono::duration<double> exec_time;
+
+    t_chain = chrono::high_resolution_clock::now();
+    chain.tour.resize(numNodes);
+    if (!warmTour(numNodes, id, chain.tour.data()))
+        ils_startTour(cost_matrix, numNodes, neighbors, numNeighbors, randomBelow(numNodes), chain.tour.data());
+    initLocalTour(lt, chain.tour.data(), numNodes, cost_matrix, neighbors, numNeighbors);
+    localSearch(lt);
+    chain.tour = lt.tour;
+    chain.cost = lt.cost;
+    chain.converged = false;
+
+    for (r=1; r<=maxIt; ++r){
+        t_start = chrono::high_resolution_clock::now();
+        for (k=0; k<ILSKICKS; ++k){
+            ils_kick(lt);
+            localSearch(lt);
+            if (lt.cost <= chain.cost){
+                chain.tour = lt.tour;
+                chain.cost = lt.cost;
+            }
+            else {  // back to the best tour
+                lt.tour = chain.tour;
+                for (i=0; i<numNodes; ++i)
+                    lt.pos[lt.tour[i]] = i;
+                lt.cost = chain.cost;
+            }
+        }
+        exec_time = chrono::high_resolution_clock::now()-t_start;
+#ifdef PRINTSCOST
+        printf("\tchain %d round %d: best %lld, %f\n",id,r,chain.cost,exec_time.count());
+#endif
+#ifdef DETAILEDCOSTS
+        asyncPrintf(generationFile,"%d %d %lld %f\n",numNodes,id,chain.cost,exec_time.count());
+#endif
+
+        lastRounds[(r-1)%earlyStopRounds] = chain.cost;
+        if (targetReached(chain.cost) ||
+            (r>=earlyStopRounds && stdDev(lastRounds.data(), earlyStopRounds)<=earlyStopParam)){
+            chain.converged = true;
+            break;
+        }
+        exec_time = chrono::high_resolution_clock::now()-t_chain;
+        if (timeLimit>=0 && exec_time.count()>=timeLimit)
+            break;
+    }
+    chain.rounds = min(r, maxIt);
+}
+
+/**
+Finds and returns the solution for the tsp with one iterated local search chain per thread
+
+@param  me: Index of the current executing node in the cluster (0 when not running under MPI)
+@param  numInstances: Amount of nodes currently working on finding the solution (1 when not running under MPI)
+@param  numThreads: Number of processing elements that are due to work on each parallel section (number of chains)
+@param  inst: Instance (its neighbor lists are computed if missing)
+@param  maxIt: Maximum number of rounds of ILSKICKS kicks of each chain
+@param  earlyStopRounds: number of latest rounds from which the standard deviation of the best cost is computed
+            in order to establish convergence
+@param  earlyStopParam: Comparison parameter for early stopping
+
+@return     Pointer to the best nodes permutation (integer index) + solution cost + convergence boolean + rounds count
+            (of the best chain; under MPI the best tour among the nodes)
+*/
+int* ils_tsp(int me, int numInstances, int numThreads, Instance *inst, int maxIt, int earlyStopRounds, double earlyStopParam){
+    int numNodes,best,t,*neighbors,*solution;
+    vector<IlsChain> chains(numThreads);
+    chrono::high_resolution_clock::time_point t_start, t_end;
+    chrono::duration<double> exec_time;
+
+    numNodes = inst->numNodes;
+    t_start = chrono::high_resolution_clock::now();
+    neighbors = getNeighbors(inst, numThreads);
+    if (gapLimit >= 0)
+        lowerBound = heldKarpBound(inst->cost_matrix, numNodes, numThreads);
+    t_end = chrono::high_resolution_clock::now();
+    exec_time = t_end-t_start;
+#ifdef PRINTSCOST
+    printf("neighbor lists and bound: %f\n",exec_time.count());
+#endif
+
+    parallel_for(numThreads, 0, numThreads, [&](int t){
+        ils_chain(chains[t], me*numThreads+t, inst->cost_matrix, numNodes, neighbors, inst->numNeighbors, maxIt, earlyStopRounds, earlyStopParam);
+    });
+
+    best = 0;
+    for (t=1; t<numThreads; ++t)
+        if (chains[t].cost < chains[best].cost)
+            best = t;
+
+    solution = new int[numNodes+3];
+    copy(chains[best].tour.begin(), chains[best].tour.end(), solution);
+    solution[numNodes] = chains[best].cost;
+    solution[numNodes+1] = chains[best].converged;
+    solution[numNodes+2] = chains[best].rounds;
+
+#ifdef MPI_VERSION
+    // best tour among the nodes (the convergence flag and the rounds stay the local ones)
+    if (numInstances > 1){
+        int *recv_buff = new int[numNodes+1];
+        MPI_Op op;
+        MPI_Op_create((MPI_User_function *)minimumCost, 1, &op);
+        MPI_Allreduce(solution, recv_buff, numNodes+1, MPI_INT, op, MPI_COMM_WORLD);
+        MPI_Op_free(&op);
+        copy(recv_buff, recv_buff+numNodes+1, solution);
+        delete[] recv_buff;
+    }
+#else
+    (void)numInstances;     // always 1 without MPI
+#endif
+    return solution;
+}
+
+#endif
@@ -5,8 +5,14 @@ Purpose: expone in/out utilities for gen_tsp.cpp
 @author Danilo Franco
 */
 
+#ifndef IN_OUT_H
+#define IN_OUT_H
+
 #include <iostream>
 #include <fstream>
+#include <cstdlib>      // atoi, getenv
+#include <cstring>      // strcmp, memcmp, memcpy
+#include <cstdio>
 
 using namespace std;
 /**
@@ -15,31 +21,161 @@ Prints a contiguous memory zone on the standard output (matrix of rows*cols elem
 @param  matrix: Pointer to the first element
 @param  rows: Number of rows in the matrix form
 @param  cols: Number of columns in the matrix form
+@param  stride: Distance between the start of two consecutive rows (0: rows are contiguous)
 */
-void printMatrix(int *matrix, int rows, int cols){
+void printMatrix(int *matrix, int rows, int cols, int stride=0){
+    if (stride==0)
+        stride = cols;
     for (int i=0; i<rows; ++i){
         cout<<endl;
         for(int j=0; j<cols; ++j)
-            cout << matrix[cols*i+j] << '\t';    
+            cout << matrix[(size_t)stride*i+j] << '\t';    
     }
     cout<<endl<<endl;
     return;
 }
 
+#define BINMAGIC "GTSPMAT1"  // first bytes of a binary instance file
+#define BINHEADER 4096      // bytes of the binary header: the matrix starts on a page boundary
+
+/**
+Reads a binary instance file: BINHEADER bytes of header (BINMAGIC, int numNodes, zero padding) followed by the
+    full numNodes*numNodes integer cost matrix in row-major order
+
+@param  cost_matrix: Pointer to the first element of contiguous memory to be written
+@param  input_f: Filename
+@param  cols: Number of columns in the matrix form of cost_matrix
+
+@return     True iff the file is a binary instance of cols nodes and has been read completely
+*/
+bool readBinMat(int *cost_matrix, const char *input_f, int cols){
+    char header[BINHEADER];
+    int numNodes;
+    size_t count;
+    FILE *pFile;
+
+    pFile = fopen(input_f, "rb");
+    if (pFile == NULL)
+        return false;
+    count = fread(header, 1, BINHEADER, pFile);
+    memcpy(&numNodes, header+8, sizeof(int));
+    if (count!=BINHEADER || memcmp(header, BINMAGIC, 8)!=0 || numNodes!=cols){
+        cerr << input_f << ": not a binary instance of " << cols << " nodes" << endl;
+        fclose(pFile);
+        return false;
+    }
+    count = fread(cost_matrix, sizeof(int), (size_t)cols*cols, pFile);
+    fclose(pFile);
+    return count == (size_t)cols*cols;
+}
+
+/**
+Writes a full cost matrix in the binary instance format read by readBinMat
+
+@param  cost_matrix: Pointer to the first element of the matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  pFile: Output stream (opened in binary mode)
+
+@return     True iff everything has been written
+*/
+bool writeBinMat(const int *cost_matrix, int numNodes, FILE *pFile){
+    char header[BINHEADER];
+    memset(header, 0, BINHEADER);
+    memcpy(header, BINMAGIC, 8);
+    memcpy(header+8, &numNodes, sizeof(int));
+    if (fwrite(header, 1, BINHEADER, pFile) != BINHEADER)
+        return false;
+    return fwrite(cost_matrix, sizeof(int), (size_t)numNodes*numNodes, pFile) == (size_t)numNodes*numNodes;
+}
+
+/**
+Checks whether a file starts with the binary instance header
+
+@param  input_f: Filename
+*/
+bool isBinMat(const char *input_f){
+    char magic[8];
+    bool binary = false;
+    FILE *pFile = fopen(input_f, "rb");
+    if (pFile != NULL){
+        binary = fread(magic, 1, 8, pFile)==8 && memcmp(magic, BINMAGIC, 8)==0;
+        fclose(pFile);
+    }
+    return binary;
+}
+
 /**
-Reads from a file of three values per line (xPos yPos Val) and stores them accordingly
+Reads from a file of three values per line (xPos yPos Val) and stores them accordingly;
+    files in the binary instance format are recognised by their header and read with readBinMat
 
 @param  cost_matrix: Pointer to the first element of contiguous memory to be written
 @param  input_f: Filename
 @param  cols: Number of columns in the matrix form of cost_matrix
+
+@return     False if the file cannot be opened (or is a malformed binary instance)
 */
-void readHeatMat(int *cost_matrix, const char *input_f, int cols){
+bool readHeatMat(int *cost_matrix, const char *input_f, int cols){
     char row[10],col[10],val[20];
+    if (isBinMat(input_f))
+        return readBinMat(cost_matrix, input_f, cols);
     ifstream myFileStream(input_f);
-    if (myFileStream.is_open())
-        while (myFileStream >> row >> col >> val){
-            cost_matrix[atoi(col)+cols*atoi(row)] = atoi(val);
-            cost_matrix[atoi(row)+cols*atoi(col)] = atoi(val);
-        }
-        return;
-}
\ No newline at end of file
+    if (!myFileStream.is_open())
+        return false;
+    while (myFileStream >> row >> col >> val){
+        cost_matrix[atoi(col)+cols*atoi(row)] = atoi(val);
+        cost_matrix[atoi(row)+cols*atoi(col)] = atoi(val);
+    }
+    return true;
+}
+
+/**
+Returns the index of the current process when launched by mpiexec/mpirun without being linked against MPI
+    (the launchers export it in the environment), so that replicated runs still write to distinct output files
+
+@return Launcher rank if any, 0 otherwise
+*/
+int launcherRank(){
+    const char *vars[] = {"OMPI_COMM_WORLD_RANK", "PMI_RANK", "PMIX_RANK", "MV2_COMM_WORLD_RANK", "SLURM_PROCID"};
+    const char *val;
+    for (int i=0; i<5; ++i){
+        val = getenv(vars[i]);
+        if (val != NULL)
+            return atoi(val);
+    }
+    return 0;
+}
+
+/**
+Returns the number of processes started on the current machine by the launcher (exported in the environment)
+
+@return Processes on this machine if known, 1 otherwise
+*/
+int launcherLocalSize(){
+    const char *vars[] = {"OMPI_COMM_WORLD_LOCAL_SIZE", "MPI_LOCALNRANKS", "MV2_COMM_WORLD_LOCAL_SIZE", "SLURM_NTASKS_PER_NODE"};
+    const char *val;
+    for (int i=0; i<4; ++i){
+        val = getenv(vars[i]);
+        if (val!=NULL && atoi(val)>0)
+            return atoi(val);
+    }
+    return 1;
+}
+
+/**
+Looks for an optional "--name value" pair among the command line arguments that follow the positional ones
+
+@param  argc: Number of command line arguments
+@param  argv: Command line arguments
+@param  first: Index of the first optional argument
+@param  name: Option name (with the leading dashes)
+
+@return     Option value, NULL if the option is not given
+*/
+const char* getOption(int argc, char *argv[], int first, const char *name){
+    for (int i=first; i<argc-1; ++i)
+        if (strcmp(argv[i], name)==0)
+            return argv[i+1];
+    return NULL;
+}
+
+#endif
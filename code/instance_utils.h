@@ -0,0 +1,289 @@
+/**
+instance_utils.h
+Purpose: Instance loading for the gen_tsp executables: the cost matrix is either read from the input file, synthesised
+    in memory by the instance generator (no file I/O at all), or memory-mapped from a local cache of already parsed
+    inputs (keyed by the content hash of the input file)
+
+@author Danilo Franco
+*/
+
+#ifndef INSTANCE_UTILS_H
+#define INSTANCE_UTILS_H
+
+#include <string>
+#include <vector>
+#include <algorithm>    // partial_sort
+#include <cstdio>       // rename, remove
+#include <fcntl.h>      // open
+#include <unistd.h>     // close, getpid
+#include <sys/mman.h>   // mmap, munmap
+#include <sys/stat.h>   // fstat
+
+#include "in_out.h"
+#include "memory_utils.h"
+#include "generator_utils.h"
+
+#define DEFAULTGENSEED 1    // instance seed when --generate is given without --gen-seed (equal on every node)
+#define NUMNEIGHBORS 16     // length of the nearest neighbor list of each node
+
+/**
+Problem instance: symmetric cost matrix and (optionally, lazily computed) nearest neighbor lists
+*/
+struct Instance {
+    int numNodes;
+    int *cost_matrix;       // numNodes*numNodes
+    int numNeighbors;       // 0 until the neighbor lists are available
+    int *neighbors;         // numNodes*numNeighbors: closest nodes of each node, by increasing cost
+    void *mapping;          // cache file mapping holding cost_matrix and neighbors (NULL if allocated)
+    size_t mappingBytes;
+};
+
+/**
+Computes the nearest neighbor lists of every node (parallel over the nodes)
+
+@param  inst: Instance whose neighbors are computed
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+*/
+void computeNeighbors(Instance *inst, int numThreads){
+    int numNodes = inst->numNodes;
+    int k = min(NUMNEIGHBORS, numNodes-1);
+    int *neighbors = allocLarge<int>((size_t)numNodes*k);
+
+    parallel_for(numThreads, 0, numNodes, [&](int i){
+        const int *costs = inst->cost_matrix+(size_t)i*numNodes;
+        vector<int> others;
+        others.reserve(numNodes-1);
+        for (int j=0; j<numNodes; ++j)
+            if (j != i)
+                others.push_back(j);
+        partial_sort(others.begin(), others.begin()+k, others.end(), [&](int a, int b){
+            return costs[a]<costs[b] || (costs[a]==costs[b] && a<b);
+        });
+        copy(others.begin(), others.begin()+k, neighbors+(size_t)i*k);
+    });
+    inst->numNeighbors = k;
+    inst->neighbors = neighbors;
+}
+
+/**
+Returns the nearest neighbor lists of the instance, computing them the first time
+
+@param  inst: Instance
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+*/
+int* getNeighbors(Instance *inst, int numThreads){
+    if (inst->neighbors == NULL)
+        computeNeighbors(inst, numThreads);
+    return inst->neighbors;
+}
+
+/**
+Releases an instance obtained with loadInstance
+
+@param  inst: Instance to be released
+*/
+void deleteInstance(Instance *inst){
+    if (inst->mapping != NULL)
+        munmap(inst->mapping, inst->mappingBytes);
+    else {
+        freeLarge(inst->cost_matrix, (size_t)inst->numNodes*inst->numNodes);
+        if (inst->neighbors != NULL)
+            freeLarge(inst->neighbors, (size_t)inst->numNodes*inst->numNeighbors);
+    }
+    delete inst;
+}
+
+/////////////////////// INSTANCE CACHE ///////////////////////
+/**
+Content hash of a file (64 bits, 8 bytes at a time over its memory mapping)
+
+@param  input_f: Filename
+@param  hash: Written with the hash
+
+@return     False if the file cannot be read
+*/
+bool fileHash(const char *input_f, unsigned long long &hash){
+    int fd;
+    size_t i, len;
+    struct stat info;
+    unsigned long long word;
+    const unsigned char *data;
+
+    fd = open(input_f, O_RDONLY);
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &info) != 0){
+        close(fd);
+        return false;
+    }
+    len = info.st_size;
+    hash = 0x84222325cbf29ce4ULL^len;
+    if (len > 0){
+        data = (const unsigned char*)mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED){
+            close(fd);
+            return false;
+        }
+        for (i=0; i+8<=len; i+=8){
+            memcpy(&word, data+i, 8);
+            hash = (hash^word)*0x100000001b3ULL;
+            hash ^= hash>>29;
+        }
+        for (; i<len; ++i)
+            hash = (hash^data[i])*0x100000001b3ULL;
+        munmap((void*)data, len);
+    }
+    close(fd);
+    word = hash;
+    hash = splitmix64(word);
+    return true;
+}
+
+/**
+Cache file of an input: <cacheDir>/<content hash>_<numNodes>.gtsp
+*/
+string cacheFile(const char *cacheDir, unsigned long long hash, int numNodes){
+    char name[64];
+    snprintf(name, 64, "/%016llx_%d.gtsp", hash, numNodes);
+    return string(cacheDir)+name;
+}
+
+/**
+Memory-maps a cache file: binary instance header (number of neighbors right after numNodes), cost matrix and
+    neighbor lists; the mapping is private, so the solver may still modify its copy of the matrix
+
+@param  cache_f: Cache filename
+@param  numNodes: Number of travelling-nodes in the problem
+
+@return     The mapped instance, NULL if there is no valid cache file
+*/
+Instance* mapCachedInstance(const char *cache_f, int numNodes){
+    int fd, header[4];
+    size_t bytes;
+    struct stat info;
+    void *base;
+    Instance *inst;
+
+    fd = open(cache_f, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &info)!=0 || pread(fd, header, sizeof(header), 0)!=sizeof(header) ||
+        memcmp(header, BINMAGIC, 8)!=0 || header[2]!=numNodes){
+        close(fd);
+        return NULL;
+    }
+    bytes = BINHEADER+((size_t)numNodes*numNodes+(size_t)numNodes*header[3])*sizeof(int);
+    if ((size_t)info.st_size != bytes){
+        close(fd);
+        return NULL;
+    }
+    base = mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    inst = new Instance;
+    inst->numNodes = numNodes;
+    inst->cost_matrix = (int*)((char*)base+BINHEADER);
+    inst->numNeighbors = header[3];
+    inst->neighbors = header[3]>0 ? inst->cost_matrix+(size_t)numNodes*numNodes : NULL;
+    inst->mapping = base;
+    inst->mappingBytes = bytes;
+    return inst;
+}
+
+/**
+Stores a parsed instance (with its neighbor lists) in the cache; written to a temporary file and renamed, so that
+    concurrent runs never map a partial file
+
+@param  inst: Instance to be stored
+@param  cache_f: Cache filename
+*/
+void storeCachedInstance(Instance *inst, const char *cache_f){
+    bool written;
+    string tmp_f = string(cache_f)+".tmp"+to_string(getpid());
+    FILE *pFile = fopen(tmp_f.c_str(), "wb");
+    if (pFile == NULL){
+        cerr << "Cannot write the instance cache " << cache_f << endl;
+        return;
+    }
+    written = writeBinMat(inst->cost_matrix, inst->numNodes, pFile);
+    written = written && fwrite(inst->neighbors, sizeof(int), (size_t)inst->numNodes*inst->numNeighbors, pFile)==(size_t)inst->numNodes*inst->numNeighbors;
+    // number of neighbors in the header, right after numNodes
+    written = written && fseek(pFile, 12, SEEK_SET)==0 && fwrite(&inst->numNeighbors, sizeof(int), 1, pFile)==1;
+    written = fclose(pFile)==0 && written;
+    if (!written || rename(tmp_f.c_str(), cache_f)!=0){
+        cerr << "Cannot write the instance cache " << cache_f << endl;
+        remove(tmp_f.c_str());
+    }
+}
+/////////////////////// END INSTANCE CACHE ///////////////////////
+
+/**
+Loads the instance of the problem according to the command line:
+    --generate random|euclid|cluster|grid|road   synthesise the instance in memory (the input file is ignored)
+    --gen-seed s                                 seed of the synthesised instance (default DEFAULTGENSEED)
+    --cache dir                                  map the parsed input from dir if already there, store it otherwise
+
+@param  input_f: Input filename (used when the instance is not synthesised)
+@param  numNodes: Number of travelling-nodes in the problem
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+@param  argc: Number of command line arguments
+@param  argv: Command line arguments
+@param  first: Index of the first optional argument
+
+@return     The instance, NULL if it cannot be read or the generator options are invalid
+*/
+Instance* loadInstance(const char *input_f, int numNodes, int numThreads, int argc, char *argv[], int first){
+    const char *mode,*seed,*cacheDir;
+    int genmode;
+    unsigned long long hash;
+    string cache_f;
+    Instance *inst;
+
+    mode = getOption(argc, argv, first, "--generate");
+    cacheDir = getOption(argc, argv, first, "--cache");
+    if (mode==NULL && cacheDir!=NULL){
+        if (!fileHash(input_f, hash)){
+            cerr << "Cannot read " << input_f << endl;
+            return NULL;
+        }
+        cache_f = cacheFile(cacheDir, hash, numNodes);
+        inst = mapCachedInstance(cache_f.c_str(), numNodes);
+        if (inst != NULL)
+            return inst;
+    }
+
+    inst = new Instance;
+    inst->numNodes = numNodes;
+    inst->cost_matrix = allocLarge<int>((size_t)numNodes*numNodes);
+    inst->numNeighbors = 0;
+    inst->neighbors = NULL;
+    inst->mapping = NULL;
+    inst->mappingBytes = 0;
+
+    if (mode != NULL){
+        genmode = genMode(mode);
+        if (genmode < 0){
+            cerr << "Unknown generator mode " << mode << endl;
+            deleteInstance(inst);
+            return NULL;
+        }
+        seed = getOption(argc, argv, first, "--gen-seed");
+        genInstance(genmode, inst->cost_matrix, numNodes, seed!=NULL ? strtoull(seed, NULL, 10) : DEFAULTGENSEED, numThreads);
+        return inst;
+    }
+
+    if (!readHeatMat(inst->cost_matrix, input_f, numNodes)){
+        cerr << "Cannot read " << input_f << endl;
+        deleteInstance(inst);
+        return NULL;
+    }
+    if (cacheDir != NULL){
+        computeNeighbors(inst, numThreads);
+        storeCachedInstance(inst, cache_f.c_str());
+    }
+    return inst;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#!/bin/bash
+#PBS -o out.txt
+#PBS -e err.txt
+#PBS -l select=1:ncpus=28:ompthreads=28 -l place=excl
+
+# dTLB misses and throughput of the phase2 runs with default pages, transparent huge pages and hugetlbfs pages
+# (hugetlb needs pages reserved beforehand, e.g. sysctl vm.nr_hugepages=4096, otherwise it falls back to thp)
+
+rm proj_HPC/code/launch/cluster/err.txt proj_HPC/code/launch/cluster/out.txt
+
+########## UTILITIES ##########
+function Round(){
+    echo ${1%%.*}
+}
+
+function Compute_Pop_Size(){
+    result=$(echo "l(1-e(l($2)/$1))/l(($1-3)/($1-1))" | bc -l)
+    result=$(Round $result)
+    echo $result
+}
+########## END UTILITIES ##########
+
+numThreads=28
+top=0.3              #percentage of top survivor
+maxIt=100
+mutP=0.5             #probability of mutation
+earlyStRound=9
+earlyStParam=1
+outDir=proj_HPC/code/results/hugepages
+
+mkdir -p $outDir
+g++ -std=c++11 -O3 -fopenmp -o proj_HPC/code/launch/cluster/seqPar proj_HPC/code/source_seqPar/gen_tsp.cpp
+
+for numCities in 1000 2000 5000 9000; do
+    pop_prob=0.1 #winning prob
+    initialPop=$(Compute_Pop_Size $numCities $pop_prob)
+    for pages in none thp hugetlb; do
+        # perf counters go to $outDir/<cities>_<pages>.perf, the usual result line to results/total/phase2/parallel
+        perf stat -e dTLB-loads,dTLB-load-misses,task-clock -o $outDir/${numCities}_${pages}.perf \
+            proj_HPC/code/launch/cluster/seqPar $numThreads $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam proj_HPC/code/launch/cluster/inputs/$numCities --hugepages $pages
+    done
+done
+
+rm proj_HPC/code/launch/cluster/seqPar
@@ -29,11 +29,12 @@ earlyStParam=100
 
 ########## COST GRAPH GENERATION ##########
 rm proj_HPC/code/launch/cluster/inputs/input_phase1.dat
-g++ -std=c++11 -O3 -o proj_HPC/code/launch/cluster/gen proj_HPC/code/generator.cpp
-proj_HPC/code/launch/cluster/gen $numCities > proj_HPC/code/launch/cluster/inputs/input_phase1.dat
+g++ -std=c++11 -O3 -fopenmp -o proj_HPC/code/launch/cluster/gen proj_HPC/code/generator.cpp
+proj_HPC/code/launch/cluster/gen $numCities --threads $numThreads > proj_HPC/code/launch/cluster/inputs/input_phase1.dat
 
 ########## SEQUENTIAL & PARALLEL MULTIPLE EXECUTION ##########
-mpic++ -std=c++11 -O3 -fopenmp -o proj_HPC/code/launch/cluster/seqPar proj_HPC/code/source_seqPar/gen_tsp.cpp
+# no MPI linkage: mpiexec only replicates the independent runs
+g++ -std=c++11 -O3 -fopenmp -o proj_HPC/code/launch/cluster/seqPar proj_HPC/code/source_seqPar/gen_tsp.cpp
 
 for i in 1 2 3; do
     pop_prob=$(echo "$i/10" | bc -l)
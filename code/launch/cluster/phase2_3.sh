@@ -15,6 +15,15 @@ function Compute_Pop_Size(){
     result=$(Round $result)
     echo $result
 }
+
+# instance of $1 cities: synthesised in memory by every rank (inProcess=1) or read from inputs/$1 (inProcess=0)
+function Input(){
+    if [ $inProcess -eq 1 ]; then
+        echo "- --generate random --gen-seed $1"
+    else
+        echo "proj_HPC/code/launch/cluster/inputs/$1"
+    fi
+}
 ########## END UTILITIES ##########
 
 nodes_tries=3
@@ -26,10 +35,12 @@ maxIt=100
 mutP=0.5             #probability of mutation
 earlyStRound=9
 earlyStParam=1
+inProcess=1          #skip the instance files
 
 ########## SEQUENTIAL & PARALLEL MULTIPLE EXECUTION ##########
-mpic++ -std=c++11 -O3 -fopenmp -o proj_HPC/code/launch/cluster/seqPar proj_HPC/code/source_seqPar/gen_tsp.cpp
-#mpic++ -std=c++11 -O3 -fopenmp -o proj_HPC/code/launch/cluster/seqPar_det proj_HPC/code/source_seqPar/gen_tsp_detailed.cpp
+# no MPI linkage: mpiexec only replicates the independent runs
+g++ -std=c++11 -O3 -fopenmp -o proj_HPC/code/launch/cluster/seqPar proj_HPC/code/source_seqPar/gen_tsp.cpp
+#g++ -std=c++11 -O3 -fopenmp -o proj_HPC/code/launch/cluster/seqPar_det proj_HPC/code/source_seqPar/gen_tsp_detailed.cpp
 
 for numCities in 100 200 300 400 500 600 700 800 900 1000 2000 5000 9000; do
     pop_prob=0.1 #winning prob
@@ -37,14 +48,14 @@ for numCities in 100 200 300 400 500 600 700 800 900 1000 2000 5000 9000; do
 
 # TOTAL COST - phase 2
     #sequential on 1 node
-    mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/seqPar 1 $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam proj_HPC/code/launch/cluster/inputs/$numCities
+    mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/seqPar 1 $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam $(Input $numCities)
     #parallel on 1 node
-    mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/seqPar $numThreads $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam proj_HPC/code/launch/cluster/inputs/$numCities
+    mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/seqPar $numThreads $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam $(Input $numCities)
 # DETAILED COST - phase 3  
     #sequential on 1 node
-    #mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/seqPar_det 1 $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam proj_HPC/code/launch/cluster/inputs/$numCities
+    #mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/seqPar_det 1 $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam $(Input $numCities)
     #parallel on 1 node
-    #mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/seqPar_det $numThreads $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam proj_HPC/code/launch/cluster/inputs/$numCities
+    #mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/seqPar_det $numThreads $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam $(Input $numCities)
 done
 
 ########## MPI MULTIPLE EXECUTION ##########
@@ -57,10 +68,10 @@ for numCities in 100 200 300 400 500 600 700 800 900 1000 2000 5000 9000; do
         initialPop=$(Compute_Pop_Size $numCities $pop_prob)
 # TOTAL COST - phase 2
         #parallel on more nodes
-        mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/mpi $numThreads $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam proj_HPC/code/launch/cluster/inputs/$numCities
+        mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/mpi $numThreads $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam $(Input $numCities)
 # DETAILED COST - phase 3
         #parallel on more nodes
-        #mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/mpi_det $numThreads $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam proj_HPC/code/launch/cluster/inputs/$numCities
+        #mpiexec -n $nodes_tries proj_HPC/code/launch/cluster/mpi_det $numThreads $numCities $initialPop $top $maxIt $mutP $earlyStRound $earlyStParam $(Input $numCities)
     done
 done
 
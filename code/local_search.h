@@ -0,0 +1,343 @@
+/**
+local_search.h
+Purpose: Local search on single tours (cost of a tour, windowed 2-opt for the decomposition mode, 2-opt and Or-opt
+    moves on the nearest neighbor lists for the iterated local search engine)
+
+@author Danilo Franco
+*/
+
+#ifndef LOCAL_SEARCH_H
+#define LOCAL_SEARCH_H
+
+#include <vector>
+#include <algorithm>    // reverse
+
+#define OROPTMAX 3      // longest segment moved by an Or-opt move
+
+/**
+Cost of a closed tour
+
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  numNodes: Number of travelling-nodes in the problem
+@param  tour: Pointer to the nodes permutation
+
+@return     Tour cost (closing edge included)
+*/
+long long tourCost(const int *cost_matrix, int numNodes, const int *tour){
+    long long total = cost_matrix[(size_t)tour[numNodes-1]*numNodes+tour[0]];
+    for (int i=0; i<numNodes-1; ++i)
+        total += cost_matrix[(size_t)tour[i]*numNodes+tour[i+1]];
+    return total;
+}
+
+/**
+2-opt moves restricted to a window of consecutive positions of the tour (taken cyclically): only edges between two
+    nodes of the window are exchanged and its first and last node stay in place, so disjoint windows can be improved
+    concurrently; the window is swept until no move improves it
+
+@param  tour: Pointer to the nodes permutation
+@param  numNodes: Number of travelling-nodes in the problem
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  first: Position of the first node of the window (may be negative or beyond numNodes)
+@param  len: Number of positions of the window (at most numNodes)
+
+@return     Decrease of the tour cost
+*/
+long long twoOpt_window(int *tour, int numNodes, const int *cost_matrix, int first, int len){
+    vector<int> w(len);
+    long long gain;
+    int i,j,a,b,c,d,delta;
+    bool improved;
+
+    first = ((first%numNodes)+numNodes)%numNodes;
+    for (i=0; i<len; ++i)
+        w[i] = tour[(first+i)%numNodes];
+
+    gain = 0;
+    do {
+        improved = false;
+        for (i=0; i<len-3; ++i){
+            a = w[i];
+            b = w[i+1];
+            for (j=i+2; j<len-1; ++j){
+                c = w[j];
+                d = w[j+1];
+                delta = cost_matrix[(size_t)a*numNodes+c]+cost_matrix[(size_t)b*numNodes+d]
+                        -cost_matrix[(size_t)a*numNodes+b]-cost_matrix[(size_t)c*numNodes+d];
+                if (delta < 0){
+                    reverse(w.begin()+i+1, w.begin()+j+1);
+                    gain -= delta;
+                    improved = true;
+                    b = w[i+1];
+                }
+            }
+        }
+    } while (improved);
+
+    for (i=0; i<len; ++i)
+        tour[(first+i)%numNodes] = w[i];
+    return gain;
+}
+
+/**
+Tour improved by local search: permutation, position of each node and queue of the nodes whose tour edges changed
+    (don't-look bits: the other nodes are not checked again)
+*/
+struct LocalTour {
+    int numNodes;
+    const int *cost_matrix;
+    const int *neighbors;       // numNodes*numNeighbors nearest neighbor lists
+    int numNeighbors;
+    vector<int> tour, pos;
+    vector<int> queue;          // circular FIFO of the nodes to be checked
+    vector<char> queued;
+    int head, count;
+    long long cost;
+};
+
+/**
+Prepares a local search on a tour; every node is queued
+
+@param  lt: Local search state
+@param  tour: Pointer to the starting nodes permutation
+@param  numNodes: Number of travelling-nodes in the problem
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  neighbors: Nearest neighbor lists (numNodes*numNeighbors)
+@param  numNeighbors: Length of each neighbor list
+*/
+void initLocalTour(LocalTour &lt, const int *tour, int numNodes, const int *cost_matrix, const int *neighbors, int numNeighbors){
+    lt.numNodes = numNodes;
+    lt.cost_matrix = cost_matrix;
+    lt.neighbors = neighbors;
+    lt.numNeighbors = numNeighbors;
+    lt.tour.assign(tour, tour+numNodes);
+    lt.pos.resize(numNodes);
+    lt.queue.resize(numNodes);
+    lt.queued.assign(numNodes, 1);
+    for (int i=0; i<numNodes; ++i){
+        lt.pos[tour[i]] = i;
+        lt.queue[i] = tour[i];
+    }
+    lt.head = 0;
+    lt.count = numNodes;
+    lt.cost = tourCost(cost_matrix, numNodes, tour);
+}
+
+inline int ls_cost(const LocalTour &lt, int a, int b){
+    return lt.cost_matrix[(size_t)a*lt.numNodes+b];
+}
+
+inline int ls_succ(const LocalTour &lt, int v){
+    int i = lt.pos[v]+1;
+    return lt.tour[i<lt.numNodes ? i : 0];
+}
+
+inline int ls_pred(const LocalTour &lt, int v){
+    int i = lt.pos[v]-1;
+    return lt.tour[i>=0 ? i : lt.numNodes-1];
+}
+
+/**
+Queues a node to be checked (if not already queued)
+
+@param  lt: Local search state
+@param  v: Node
+*/
+inline void ls_push(LocalTour &lt, int v){
+    if (!lt.queued[v]){
+        lt.queued[v] = 1;
+        lt.queue[(lt.head+lt.count)%lt.numNodes] = v;
+        ++lt.count;
+    }
+}
+
+/**
+Reverses the path between two positions of the tour (taken cyclically, first to last included); the complementary
+    path is reversed instead when shorter, which gives the same cycle
+
+@param  lt: Local search state
+@param  first: Position of the first node of the path
+@param  last: Position of the last node of the path
+*/
+void ls_reverse(LocalTour &lt, int first, int last){
+    int n,len,k,v;
+    n = lt.numNodes;
+    len = (last-first+n)%n+1;
+    if (2*len > n){
+        k = first;
+        first = (last+1)%n;
+        last = (k-1+n)%n;
+        len = n-len;
+    }
+    for (k=0; k<len/2; ++k){
+        v = lt.tour[first];
+        lt.tour[first] = lt.tour[last];
+        lt.tour[last] = v;
+        lt.pos[lt.tour[first]] = first;
+        lt.pos[lt.tour[last]] = last;
+        first = first+1<n ? first+1 : 0;
+        last = last>0 ? last-1 : n-1;
+    }
+}
+
+/**
+First improving 2-opt move for a node: one of its tour edges are replaced by an edge towards one of its neighbors (scanned
+    while that edge is shorter than the removed one)
+
+@param  lt: Local search state
+@param  a: Node
+
+@return     True iff a move has been applied
+*/
+bool ls_twoOpt(LocalTour &lt, int a){
+    const int *nb = lt.neighbors+(size_t)a*lt.numNeighbors;
+    int dir,k,b,c,d,removed,delta;
+    for (dir=0; dir<2; ++dir){
+        b = dir==0 ? ls_succ(lt, a) : ls_pred(lt, a);
+        removed = ls_cost(lt, a, b);
+        for (k=0; k<lt.numNeighbors; ++k){
+            c = nb[k];
+            if (ls_cost(lt, a, c) >= removed)
+                break;
+            d = dir==0 ? ls_succ(lt, c) : ls_pred(lt, c);
+            if (c==b || d==a)
+                continue;
+            delta = removed+ls_cost(lt, c, d)-ls_cost(lt, a, c)-ls_cost(lt, b, d);
+            if (delta > 0){
+                // a b ... c d becomes a c ... b d (d b ... a c for the predecessors)
+                if (dir == 0)
+                    ls_reverse(lt, lt.pos[b], lt.pos[c]);
+                else
+                    ls_reverse(lt, lt.pos[a], lt.pos[d]);
+                lt.cost -= delta;
+                ls_push(lt, a);
+                ls_push(lt, b);
+                ls_push(lt, c);
+                ls_push(lt, d);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+Moves the segment of len nodes starting at s1 between the adjacent nodes x and y=succ(x), shifting the shorter of the
+    two paths that separate it from its new place
+
+@param  lt: Local search state
+@param  s1: First node of the segment
+@param  len: Number of nodes of the segment
+@param  x: Node after which the segment is placed
+@param  reversed: Whether the segment is placed backwards
+*/
+void ls_moveSegment(LocalTour &lt, int s1, int len, int x, bool reversed){
+    int n,i,k,start,forward,backward,from,seg[OROPTMAX];
+    n = lt.numNodes;
+    i = lt.pos[s1];
+    for (k=0; k<len; ++k)
+        seg[k] = lt.tour[(i+k)%n];
+    forward = (lt.pos[x]-(i+len)%n+n)%n+1;     // nodes from succ(segment) to x
+    backward = (i-1-lt.pos[x]+n)%n;             // nodes from succ(x) to pred(segment)
+
+    if (forward <= backward){
+        for (k=0; k<forward; ++k){
+            lt.tour[(i+k)%n] = lt.tour[(i+len+k)%n];
+            lt.pos[lt.tour[(i+k)%n]] = (i+k)%n;
+        }
+        start = (i+forward)%n;
+    }
+    else {
+        from = (lt.pos[x]+1)%n;
+        for (k=backward-1; k>=0; --k){
+            lt.tour[(from+k+len)%n] = lt.tour[(from+k)%n];
+            lt.pos[lt.tour[(from+k+len)%n]] = (from+k+len)%n;
+        }
+        start = from;
+    }
+    for (k=0; k<len; ++k){
+        lt.tour[(start+k)%n] = reversed ? seg[len-1-k] : seg[k];
+        lt.pos[lt.tour[(start+k)%n]] = (start+k)%n;
+    }
+}
+
+/**
+First improving Or-opt move for a node: the segment of 1 to OROPTMAX nodes starting at it is moved (in either
+    direction) next to a neighbor of one of its ends
+
+@param  lt: Local search state
+@param  a: Node
+
+@return     True iff a move has been applied
+*/
+bool ls_orOpt(LocalTour &lt, int a){
+    int n,len,s2,p,nx,gain,end,near,far,k,c,x,y,delta;
+    const int *nb;
+    n = lt.numNodes;
+    for (len=1; len<=OROPTMAX && len+3<=n; ++len){
+        s2 = lt.tour[(lt.pos[a]+len-1)%n];
+        p = ls_pred(lt, a);
+        nx = ls_succ(lt, s2);
+        gain = ls_cost(lt, p, a)+ls_cost(lt, s2, nx)-ls_cost(lt, p, nx);
+        if (gain <= 0)
+            continue;
+        for (end=0; end<2; ++end){
+            // the near end of the segment becomes adjacent to its neighbor c
+            near = end==0 ? a : s2;
+            far = end==0 ? s2 : a;
+            nb = lt.neighbors+(size_t)near*lt.numNeighbors;
+            for (k=0; k<lt.numNeighbors; ++k){
+                c = nb[k];
+                if (ls_cost(lt, near, c) >= gain)
+                    break;
+                if ((lt.pos[c]-lt.pos[a]+n)%n < len)
+                    continue;
+                // c near ... far succ(c)
+                y = ls_succ(lt, c);
+                delta = gain+ls_cost(lt, c, y)-ls_cost(lt, c, near)-ls_cost(lt, far, y);
+                if ((lt.pos[y]-lt.pos[a]+n)%n>=len && delta>0){
+                    x = c;
+                    ls_moveSegment(lt, a, len, x, near==s2);
+                    goto applied;
+                }
+                // pred(c) far ... near c
+                x = ls_pred(lt, c);
+                delta = gain+ls_cost(lt, x, c)-ls_cost(lt, x, far)-ls_cost(lt, near, c);
+                if ((lt.pos[x]-lt.pos[a]+n)%n>=len && delta>0){
+                    y = c;
+                    ls_moveSegment(lt, a, len, x, near==a);
+                    goto applied;
+                }
+            }
+        }
+    }
+    return false;
+
+applied:
+    lt.cost -= delta;
+    ls_push(lt, p);
+    ls_push(lt, nx);
+    ls_push(lt, a);
+    ls_push(lt, s2);
+    ls_push(lt, x);
+    ls_push(lt, y);
+    return true;
+}
+
+/**
+Applies 2-opt and Or-opt moves to the queued nodes until none improves the tour
+
+@param  lt: Local search state
+*/
+void localSearch(LocalTour &lt){
+    int v;
+    while (lt.count > 0){
+        v = lt.queue[lt.head];
+        lt.head = lt.head+1<lt.numNodes ? lt.head+1 : 0;
+        --lt.count;
+        lt.queued[v] = 0;
+        while (ls_twoOpt(lt, v) || ls_orOpt(lt, v));
+    }
+}
+
+#endif
@@ -0,0 +1,139 @@
+/**
+memory_utils.h
+Purpose: Allocation utilities for the large buffers of the solver (cost matrix, population rows and their attributes);
+    the largest ones can be backed by huge pages to reduce the TLB misses of their random accesses
+
+@author Danilo Franco
+*/
+
+#ifndef MEMORY_UTILS_H
+#define MEMORY_UTILS_H
+
+#include <cstdlib>      // posix_memalign, free
+#include <new>          // bad_alloc
+#include <algorithm>    // fill
+#include <iostream>
+#include <cstring>      // strcmp
+#include <sys/mman.h>   // mmap, madvise, munmap
+
+#define CACHELINE 64    // bytes; also the width of an AVX-512 register
+#define HUGEPAGE (2UL<<20)  // bytes of a (x86-64) huge page
+
+#define HUGEPAGES_NONE 0        // default pages (whatever the system policy gives)
+#define HUGEPAGES_THP 1         // transparent huge pages requested with madvise
+#define HUGEPAGES_HUGETLB 2     // explicit hugetlbfs pages (need vm.nr_hugepages), falling back to THP
+
+int hugePagesMode = HUGEPAGES_NONE;
+
+/**
+Sets the huge pages mode from its command line name
+
+@param  name: "none", "thp" or "hugetlb"
+
+@return     True iff the name is a known mode
+*/
+bool setHugePages(const char *name){
+    if (strcmp(name, "none")==0)
+        hugePagesMode = HUGEPAGES_NONE;
+    else if (strcmp(name, "thp")==0)
+        hugePagesMode = HUGEPAGES_THP;
+    else if (strcmp(name, "hugetlb")==0)
+        hugePagesMode = HUGEPAGES_HUGETLB;
+    else
+        return false;
+    return true;
+}
+
+/**
+Allocates an array aligned to the cache line
+
+@param  count: Number of elements
+
+@return     Pointer to the first element (throws bad_alloc on failure)
+*/
+template<typename T>
+T* allocAligned(size_t count){
+    void *ptr;
+    if (posix_memalign(&ptr, CACHELINE, (count>0 ? count : 1)*sizeof(T)) != 0)
+        throw bad_alloc();
+    return (T*)ptr;
+}
+
+/**
+Releases an array obtained with allocAligned
+
+@param  ptr: Pointer to the first element
+*/
+template<typename T>
+void freeAligned(T *ptr){
+    free(ptr);
+}
+
+/**
+Returns the mapped length of a large buffer of count elements (a whole number of huge pages unless hugePagesMode is none)
+*/
+template<typename T>
+size_t largeBytes(size_t count){
+    size_t bytes, unit;
+    bytes = (count>0 ? count : 1)*sizeof(T);
+    unit = hugePagesMode==HUGEPAGES_NONE ? 4096 : HUGEPAGE;
+    return (bytes+unit-1)/unit*unit;
+}
+
+/**
+Allocates a large, zero-filled array with anonymous memory mapping according to hugePagesMode
+    (THP: the mapping is aligned to a huge page boundary and marked with MADV_HUGEPAGE)
+
+@param  count: Number of elements
+
+@return     Pointer to the first element (page aligned, throws bad_alloc on failure)
+*/
+template<typename T>
+T* allocLarge(size_t count){
+    static bool warned = false;
+    size_t bytes, head;
+    char *base, *aligned;
+    void *ptr;
+
+    bytes = largeBytes<T>(count);
+    if (hugePagesMode == HUGEPAGES_HUGETLB){
+        ptr = mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED)
+            return (T*)ptr;
+        if (!warned)
+            cerr << "hugetlb allocation of " << bytes << " bytes failed, falling back to transparent huge pages" << endl;
+        warned = true;
+    }
+    if (hugePagesMode == HUGEPAGES_NONE){
+        ptr = mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+            throw bad_alloc();
+        return (T*)ptr;
+    }
+
+    // over-map by one huge page, then trim head and tail so that the buffer starts on a huge page boundary
+    base = (char*)mmap(NULL, bytes+HUGEPAGE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        throw bad_alloc();
+    aligned = (char*)(((size_t)base+HUGEPAGE-1)/HUGEPAGE*HUGEPAGE);
+    head = aligned-base;
+    if (head > 0)
+        munmap(base, head);
+    if (HUGEPAGE-head > 0)
+        munmap(aligned+bytes, HUGEPAGE-head);
+    madvise(aligned, bytes, MADV_HUGEPAGE);
+    return (T*)aligned;
+}
+
+/**
+Releases an array obtained with allocLarge (hugePagesMode must not have changed in between)
+
+@param  ptr: Pointer to the first element
+@param  count: Number of elements it was allocated with
+*/
+template<typename T>
+void freeLarge(T *ptr, size_t count){
+    munmap(ptr, largeBytes<T>(count));
+}
+
+#endif
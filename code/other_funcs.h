@@ -5,6 +5,46 @@ Purpose: container for old versions code that are no longer needed or outdated
 @author Danilo Franco
 */
 
+#ifndef OTHER_FUNCS_H
+#define OTHER_FUNCS_H
+
+#include <set>
+
+//////////////////// 1ST VERSION OF CROSSOVER: TAKEN NODES IN A SET ////////////////////////
+void crossover_firstHalf_withMutation_set(const int *parent1, const int *parent2, int *son, int numNodes, int probCentile){
+    set<int> nodes;
+    int j,k,half,elem,swap1,swap2;
+
+    half = floor(numNodes/2);
+
+    // take first half from parent1
+    for(j=0; j<half; ++j){
+        elem = parent1[j];
+        son[j] = elem;
+        nodes.insert(elem);
+    }
+    // add the remaining elements from parent2
+    for(k=0; k<numNodes; ++k){
+        elem = parent2[k];
+        if(nodes.find(elem)==nodes.end()){
+            son[j] = elem;
+            ++j;
+        }
+    }
+    // MUTATION
+    if((rand()%100+1)<=probCentile){
+        swap1=rand()%numNodes;
+        do {
+            swap2=rand()%numNodes;
+        } while(swap2==swap1);
+
+        elem = son[swap1];
+        son[swap1] = son[swap2];
+        son[swap2] = elem;
+    }
+    return;
+}
+
 //////////////////// 1ST VERSION: NEW ALLOCATION WITH COPY ////////////////////////
 void move_top2(int *generation_rank, int *generation, int best_num, int numNodes){
     int i,*start,*copy_mat;
@@ -73,6 +113,91 @@ void generate2(int *generation, int population, int best_num, int numNodes, doub
 }
 ///////////////////////////////////// END ///////////////////////////////////
 
+///////////////////////// 1ST VERSION OF MERGESORT: ONE TASK PER CORE, PAIRWISE MERGES /////////////////////////
+/**
+External method of the recursive mergesort algorithm, deals with starting all the parallel phases
+    (one block per core sorted sequentially, then merged pairwise)
+
+@param  generation_cost: Sorting array
+@param  generation_rank: Index array
+@param  low: Starting sorting index [included]
+@param  high: Ending sorting index [included]
+@param  cores: Number of parallel processing units
+*/
+void mergesort2(int* generation_cost, int* generation_rank, int low, int high, int cores) {
+    int numElems,q,fixRemainder,rem,start,end,k,*temp;
+
+    numElems = high+1-low;
+    temp = new int[numElems*2];
+    q = numElems/cores;   // floor quotient
+    fixRemainder = numElems%cores; // remainder
+
+    ///////////////////////   SORT   ///////////////////////
+    int *bounds;
+    start = low;
+    rem = fixRemainder;
+    bounds = new int[cores*2];
+
+    for (k=0; k<cores; ++k){
+        if (rem){
+            end = start+q;
+            rem--;
+        }
+        else
+            end = start+q-1;
+
+        bounds[k*2] = start;
+        bounds[k*2+1] = end;
+        start = end+1;
+    }
+    parallel_tasks(cores, [&](int t){
+        mergesort_help(generation_cost, generation_rank, temp, bounds[t*2], bounds[t*2+1]);
+    });
+    
+    ///////////////////////   MERGE   ///////////////////////
+    int flag,hh,ll,kk,*idx;
+
+    rem = fixRemainder;
+    k = cores;
+    flag = 0;
+    hh = low-1;
+    idx = new int[cores+1]; 
+    idx[0]=low;
+
+    for (kk=0; kk<cores;){
+        ll=hh+1;
+        if(rem){
+            hh=ll+q;
+            rem--;
+        }
+        else
+            hh=ll+q-1;
+
+        idx[++kk]=hh;
+    }
+
+    while (k != 1) {
+        parallel_tasks(k/2, [&](int t){
+            int p = t*2;
+            merge(generation_cost, generation_rank, temp, idx[p]+(p!=0), idx[p+1], idx[p+2]);
+        });
+
+        for(kk=0; kk<k; kk+=2)
+            idx[kk/2+1]= idx[kk+2];
+
+        flag = k&1; // remainder
+        k = k>>1;
+        k += flag;
+        if (flag) idx[k]=idx[2*k-1]; 
+    }
+    
+    delete[] temp;
+    delete[] bounds;
+    delete[] idx;
+}
+///////////////////////////////////// END ///////////////////////////////////
+
+#ifdef MPI_VERSION
 /////////////////////////// EXCHANGE BETWEEN TWO NODES //////////////////////////
 void transferReceive_bests_between2(int* generation, int* generation_cost, int numNodes, int bestNum, int me, int numInstances, int messageNum){
     int sendTo, recvFrom;
@@ -153,4 +278,7 @@ void transferReceive_bests_barrier(int *generation, int *generation_cost, int nu
         generation_cost[bestNum-1] = cost;
     }
     return;
-}
\ No newline at end of file
+}
+#endif
+
+#endif
@@ -0,0 +1,341 @@
+/**
+parallel_backend.h
+Purpose: Parallel execution backends for genetic_utils.h and sorting_utils.h: openMP (static scheduling) or a
+    work-stealing thread pool (one Chase-Lev deque per worker), selected at runtime through parallelBackend
+
+@author Danilo Franco
+*/
+
+#ifndef PARALLEL_BACKEND_H
+#define PARALLEL_BACKEND_H
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <cstring>      // strcmp
+
+#define BACKEND_OPENMP 0
+#define BACKEND_WORKSTEALING 1
+
+#define WS_DEQUE_SIZE 4096  // tasks held by each deque (power of two); when full, the task is executed by the owner
+#define WS_CHUNKS 8         // chunks per thread in which a parallel_for range is split for the work-stealing backend
+
+int parallelBackend = BACKEND_OPENMP;
+
+/**
+Sets the parallel backend from its command line name
+
+@param  name: "omp" or "ws"
+
+@return     True iff the name is a known backend
+*/
+bool setParallelBackend(const char *name){
+    if (strcmp(name, "omp")==0)
+        parallelBackend = BACKEND_OPENMP;
+    else if (strcmp(name, "ws")==0)
+        parallelBackend = BACKEND_WORKSTEALING;
+    else
+        return false;
+    return true;
+}
+
+/////////////////////// WORK STEALING ///////////////////////
+/**
+Unit of work of the pool: the (type-erased) body is called with the task index; pending is decreased once done
+*/
+struct WSTask {
+    void (*invoke)(void *body, int index);
+    void *body;
+    int index;
+    atomic<int> *pending;
+};
+
+/**
+Chase-Lev work-stealing deque (fixed capacity): the owner pushes and pops at the bottom, thieves steal from the top
+*/
+class WSDeque {
+    atomic<long> top, bottom;
+    atomic<WSTask*> buffer[WS_DEQUE_SIZE];
+
+public:
+    WSDeque(): top(0), bottom(0) {}
+
+    /**
+    Owner only: appends a task at the bottom
+
+    @return     False if the deque is full
+    */
+    bool push(WSTask *task){
+        long b = bottom.load(memory_order_relaxed);
+        long t = top.load(memory_order_acquire);
+        if (b-t >= WS_DEQUE_SIZE)
+            return false;
+        buffer[b&(WS_DEQUE_SIZE-1)].store(task, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        bottom.store(b+1, memory_order_relaxed);
+        return true;
+    }
+
+    /**
+    Owner only: takes the last pushed task
+
+    @return     The task, NULL if the deque is empty or the last task has been stolen meanwhile
+    */
+    WSTask* pop(){
+        long b = bottom.load(memory_order_relaxed)-1;
+        bottom.store(b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        long t = top.load(memory_order_relaxed);
+        WSTask *task = NULL;
+        if (t <= b){
+            task = buffer[b&(WS_DEQUE_SIZE-1)].load(memory_order_relaxed);
+            if (t == b){    // last element: race against thieves
+                if (!top.compare_exchange_strong(t, t+1, memory_order_seq_cst, memory_order_relaxed))
+                    task = NULL;
+                bottom.store(b+1, memory_order_relaxed);
+            }
+        }
+        else
+            bottom.store(b+1, memory_order_relaxed);
+        return task;
+    }
+
+    /**
+    Any thread: takes the oldest task
+
+    @return     The task, NULL if the deque is empty or another thief won the race
+    */
+    WSTask* steal(){
+        long t = top.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        long b = bottom.load(memory_order_acquire);
+        if (t < b){
+            WSTask *task = buffer[t&(WS_DEQUE_SIZE-1)].load(memory_order_relaxed);
+            if (!top.compare_exchange_strong(t, t+1, memory_order_seq_cst, memory_order_relaxed))
+                return NULL;
+            return task;
+        }
+        return NULL;
+    }
+};
+
+thread_local int wsWorkerId = -1;   // deque owned by the current thread (-1: not a pool thread)
+
+/**
+Pool of numThreads-1 background workers plus the thread entering the parallel region (worker 0); idle workers
+    steal from random victims while a region is active and sleep otherwise
+*/
+class WorkStealingPool {
+    int numWorkers;
+    WSDeque *deques;
+    vector<thread> workers;
+    atomic<bool> stop;
+    atomic<int> activeRegions;
+    mutex sleepLock, regionLock;
+    condition_variable wakeUp;
+
+    void workerLoop(int id){
+        unsigned seed = id;
+        wsWorkerId = id;
+        while (!stop.load()){
+            WSTask *task = stealAny(seed);
+            if (task != NULL)
+                execute(task);
+            else if (activeRegions.load() > 0)
+                this_thread::yield();
+            else {
+                unique_lock<mutex> lock(sleepLock);
+                wakeUp.wait(lock, [this]{ return stop.load() || activeRegions.load()>0; });
+            }
+        }
+    }
+
+    WSTask* stealAny(unsigned &seed){
+        int k,victim;
+        WSTask *task;
+        seed = seed*1103515245+12345;
+        victim = (seed>>16)%numWorkers;
+        for (k=0; k<numWorkers; ++k){
+            task = deques[(victim+k)%numWorkers].steal();
+            if (task != NULL)
+                return task;
+        }
+        return NULL;
+    }
+
+public:
+    WorkStealingPool(int numThreads): numWorkers(numThreads), stop(false), activeRegions(0) {
+        deques = new WSDeque[numWorkers];
+        for (int i=1; i<numWorkers; ++i)
+            workers.push_back(thread(&WorkStealingPool::workerLoop, this, i));
+    }
+
+    ~WorkStealingPool(){
+        {
+            lock_guard<mutex> lock(sleepLock);
+            stop.store(true);
+        }
+        wakeUp.notify_all();
+        for (size_t i=0; i<workers.size(); ++i)
+            workers[i].join();
+        delete[] deques;
+    }
+
+    int size(){
+        return numWorkers;
+    }
+
+    static void execute(WSTask *task){
+        task->invoke(task->body, task->index);
+        task->pending->fetch_sub(1, memory_order_release);
+    }
+
+    /**
+    Runs body on the calling thread as worker 0, with the other workers ready to steal the tasks it spawns
+    */
+    template<typename F>
+    void region(F &body){
+        if (wsWorkerId >= 0){   // nested region from inside a task: the pool is already running
+            body();
+            return;
+        }
+        lock_guard<mutex> owner(regionLock);
+        wsWorkerId = 0;
+        {
+            lock_guard<mutex> lock(sleepLock);
+            activeRegions.fetch_add(1);
+        }
+        wakeUp.notify_all();
+        body();
+        activeRegions.fetch_sub(1);
+        wsWorkerId = -1;
+    }
+
+    /**
+    Spawns numTasks tasks on the deque of the calling worker and helps (own tasks first, then stealing)
+        until all of them are completed
+    */
+    template<typename F>
+    void spawnAndWait(F &body, int numTasks){
+        int k;
+        unsigned seed = wsWorkerId;
+        atomic<int> pending(numTasks);
+        vector<WSTask> tasks(numTasks);
+        WSDeque &own = deques[wsWorkerId];
+
+        for (k=numTasks-1; k>=0; --k){   // pushed in reverse: the owner pops them in index order
+            tasks[k].invoke = [](void *b, int index){ (*(F*)b)(index); };
+            tasks[k].body = &body;
+            tasks[k].index = k;
+            tasks[k].pending = &pending;
+            if (!own.push(&tasks[k]))
+                execute(&tasks[k]);
+        }
+        while (pending.load(memory_order_acquire) > 0){
+            WSTask *task = own.pop();
+            if (task == NULL)
+                task = stealAny(seed);
+            if (task != NULL)
+                execute(task);
+            else
+                this_thread::yield();
+        }
+    }
+};
+
+WorkStealingPool *wsPool = NULL;
+
+/**
+Returns the work-stealing pool, (re)creating it when the requested number of workers changes
+
+@param  numThreads: Number of workers (calling thread included)
+*/
+WorkStealingPool* getPool(int numThreads){
+    if (wsWorkerId >= 0)    // already inside the pool: keep the running one
+        return wsPool;
+    if (wsPool == NULL || wsPool->size() != numThreads){
+        delete wsPool;
+        wsPool = new WorkStealingPool(numThreads);
+    }
+    return wsPool;
+}
+/////////////////////// END WORK STEALING ///////////////////////
+
+/**
+Executes body(i) for each i in [begin, end) with the selected backend
+
+@param  numThreads: Number of processing elements that are due to work on the loop
+@param  begin: First index [included]
+@param  end: Last index [excluded]
+@param  body: Callable object with signature void(int)
+*/
+template<typename F>
+void parallel_for(int numThreads, int begin, int end, F body){
+    int i;
+    if (parallelBackend == BACKEND_WORKSTEALING && numThreads > 1){
+        int numChunks, len;
+        len = end-begin;
+        numChunks = min(len, numThreads*WS_CHUNKS);
+        if (numChunks <= 0)
+            return;
+        auto chunk = [&](int k){
+            int from = begin+(long)len*k/numChunks;
+            int to = begin+(long)len*(k+1)/numChunks;
+            for (int j=from; j<to; ++j)
+                body(j);
+        };
+        WorkStealingPool *pool = getPool(numThreads);
+        auto run = [&](){ pool->spawnAndWait(chunk, numChunks); };
+        pool->region(run);
+        return;
+    }
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for(i=begin; i<end; ++i)
+        body(i);
+}
+
+/**
+Runs body on a single thread while the team of numThreads is available to the tasks spawned by parallel_tasks
+    (openMP: parallel + single region)
+
+@param  numThreads: Number of processing elements of the team
+@param  body: Callable object with signature void()
+*/
+template<typename F>
+void parallel_region(int numThreads, F body){
+    if (parallelBackend == BACKEND_WORKSTEALING && numThreads > 1){
+        getPool(numThreads)->region(body);
+        return;
+    }
+
+    #pragma omp parallel num_threads(numThreads)
+    #pragma omp single
+    body();
+}
+
+/**
+Runs body(k) for each k in [0, numTasks) as independent tasks and waits for all of them;
+    must be called inside parallel_region
+
+@param  numTasks: Number of tasks
+@param  body: Callable object with signature void(int)
+*/
+template<typename F>
+void parallel_tasks(int numTasks, F body){
+    int k;
+    if (parallelBackend == BACKEND_WORKSTEALING && wsWorkerId >= 0){
+        wsPool->spawnAndWait(body, numTasks);
+        return;
+    }
+
+    for (k=0; k<numTasks; ++k){
+        #pragma omp task shared(body) firstprivate(k)
+        body(k);
+    }
+    #pragma omp taskwait
+}
+
+#endif
@@ -0,0 +1,427 @@
+/**
+pipeline_utils.h
+Purpose: Pipelined generation step for genetic_engine.h (openMP threads): each thread generates, evaluates and sorts
+    its own chunk of newborns and then joins a tree of merges as soon as its partner is done, while the parents are
+    read from the previous permutation matrix (no separate move_top phase); the sorted runs of the threads are merged
+    as they complete instead of after a barrier on the whole generation, and the last merge (the parents of the next
+    generation) is left to thread 0 at the start of the next step, while the other threads already copy the parents
+    and generate the newborns whose parents are ranked
+
+@author Danilo Franco
+*/
+
+#ifndef PIPELINE_UTILS_H
+#define PIPELINE_UTILS_H
+
+#include <atomic>
+#include <thread>       // this_thread::yield
+#include <chrono>
+#include <omp.h>
+
+#include "genetic_utils.h"
+
+#define PIPELINE_OFF 0
+#define PIPELINE_BARRIER 1      // same per-thread schedule with a barrier after each phase (reference for the traces)
+#define PIPELINE_OVERLAP 2
+#define PIPECHUNK 32            // parents ranked by the root merge between two publications of its progress
+
+int pipelineMode = PIPELINE_OFF;
+
+/**
+Sets the pipeline mode from its command line name
+
+@param  name: "barrier" or "overlap"
+
+@return     True iff the name is a known mode
+*/
+bool setPipelineMode(const char *name){
+    if (strcmp(name, "barrier")==0)
+        pipelineMode = PIPELINE_BARRIER;
+    else if (strcmp(name, "overlap")==0)
+        pipelineMode = PIPELINE_OVERLAP;
+    else
+        return false;
+    return true;
+}
+
+/**
+State of the pipelined engine: ranking of the current generation (two sorted runs, whose merge is pending until the
+    next step) and of its parents, per-thread trace
+*/
+struct Pipeline {
+    int numThreads;
+    int *rank;                  // rank[i]: row of the i-th element of the runs [0,mid) and [mid,size) of the generation
+    int *rank_next;             // ranking being built by the running step
+    int *temp;                  // mergesort auxiliary array (cost and index interleaved)
+    int *best;                  // best[p]: row of the p-th parent, final for p < merged
+    int *best_cost;             // best_cost[p]: cost of the p-th parent
+    int *draws;                 // parents drawn for each newborn (two per newborn)
+    int mid;                    // start of the second run of rank
+    int nextA;                  // next element of the first run to be merged
+    int nextB;                  // next element of the second run to be merged
+    atomic<int> merged;         // parents ranked so far by the root merge
+    atomic<int> *done;          // done[t]: thread t has merged its subtree of sorted runs
+    double *work;               // seconds spent working by each thread in the last step
+    double *idle;               // seconds spent waiting (parents, partners, barriers, end of step) by each thread
+};
+
+/**
+Allocates the pipeline of a ranked population (its first bestNum rows are the sorted parents)
+
+@param  pop: Population
+@param  bestNum: Number of best elements (parents) that will produce the next generation
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+
+@return     Pointer to the new pipeline
+*/
+Pipeline* newPipeline(Population *pop, int bestNum, int numThreads){
+    Pipeline *pipe = new Pipeline;
+    pipe->numThreads = numThreads;
+    pipe->rank = new int[pop->size];
+    pipe->rank_next = new int[pop->size];
+    pipe->temp = new int[pop->size*2];
+    pipe->best = new int[bestNum];
+    pipe->best_cost = new int[bestNum];
+    pipe->draws = new int[(pop->size-bestNum)*2];
+    pipe->done = new atomic<int>[numThreads];
+    pipe->work = new double[numThreads];
+    pipe->idle = new double[numThreads];
+    for (int p=0; p<bestNum; ++p){
+        pipe->best[p] = p;
+        pipe->best_cost[p] = pop->cost[p];
+    }
+    pipe->mid = bestNum;
+    pipe->merged.store(bestNum);
+    return pipe;
+}
+
+/**
+Releases a pipeline obtained with newPipeline
+
+@param  pipe: Pipeline to be released
+*/
+void deletePipeline(Pipeline *pipe){
+    delete[] pipe->rank;
+    delete[] pipe->rank_next;
+    delete[] pipe->temp;
+    delete[] pipe->best;
+    delete[] pipe->best_cost;
+    delete[] pipe->draws;
+    delete[] pipe->done;
+    delete[] pipe->work;
+    delete[] pipe->idle;
+    delete pipe;
+}
+
+/**
+Root merge of the two runs of the generation, resumed where it stopped and carried on until count parents are ranked
+    (the other elements of the generation do not survive it); the progress is published every PIPECHUNK parents
+
+@param  pipe: Pipeline
+@param  pop: Population
+@param  bestNum: Number of best elements (parents) that will produce the next generation
+@param  count: Number of parents that must be ranked on return
+*/
+void pipeline_merge(Pipeline *pipe, Population *pop, int bestNum, int count){
+    int k,a,b;
+    const int *cost = pop->cost;
+
+    k = pipe->merged.load(memory_order_relaxed);
+    a = pipe->nextA;
+    b = pipe->nextB;
+    count = min(count, bestNum);
+    while (k < count){
+        if (b>=pop->size || (a<pipe->mid && cost[a]<=cost[b])){
+            pipe->best[k] = pipe->rank[a];
+            pipe->best_cost[k] = cost[a++];
+        }
+        else {
+            pipe->best[k] = pipe->rank[b];
+            pipe->best_cost[k] = cost[b++];
+        }
+        if (++k%PIPECHUNK == 0)
+            pipe->merged.store(k, memory_order_release);
+    }
+    pipe->nextA = a;
+    pipe->nextB = b;
+    pipe->merged.store(k, memory_order_release);
+}
+
+/**
+Costs of the best elements of the current generation (the root merge is carried on as far as needed)
+
+@param  pipe: Pipeline
+@param  pop: Population
+@param  bestNum: Number of best elements (parents) that will produce the next generation
+@param  count: Number of best elements needed
+
+@return     Pointer to the sorted costs of the (at least count) best elements
+*/
+const int* pipeline_best(Pipeline *pipe, Population *pop, int bestNum, int count){
+    pipeline_merge(pipe, pop, bestNum, count);
+    return pipe->best_cost;
+}
+
+/**
+Moves the parents on top of the permutation matrix (standard layout, needed by the message exchange and at the end)
+
+@param  pipe: Pipeline
+@param  pop: Population
+@param  bestNum: Number of best elements (parents) that will produce the next generation
+*/
+void pipeline_flush(Pipeline *pipe, Population *pop, int bestNum){
+    pipeline_merge(pipe, pop, bestNum, bestNum);
+    move_top(pipe->best, pop, bestNum, 0);
+    for (int p=0; p<bestNum; ++p){
+        pipe->best[p] = p;
+        pop->cost[p] = pipe->best_cost[p];
+    }
+}
+
+/**
+Takes back a population whose parents have been changed in place (after a message exchange or cost updates): the rows
+    that are no more ranked are sorted again among the parents by insertion
+
+@param  pipe: Pipeline (flushed)
+@param  pop: Population
+@param  bestNum: Number of best elements (parents) that will produce the next generation
+*/
+void pipeline_resume(Pipeline *pipe, Population *pop, int bestNum){
+    if (pop->ranked < bestNum){
+        insertionSort(pipe->best, pop->cost, bestNum-1);
+        pop->ranked = bestNum;
+    }
+    copy(pop->cost, pop->cost+bestNum, pipe->best_cost);
+}
+
+/**
+Counts the distinct parents (pipelined counterpart of countDistinct)
+
+@param  pipe: Pipeline
+@param  pop: Population
+@param  bestNum: Number of best elements (parents) that will produce the next generation
+*/
+int pipeline_distinct(Pipeline *pipe, Population *pop, int bestNum){
+    set<unsigned long long> distinct;
+    pipeline_merge(pipe, pop, bestNum, bestNum);
+    for (int p=0; p<bestNum; ++p)
+        distinct.insert(pop->hash[pipe->best[p]]);
+    return distinct.size();
+}
+
+/**
+One generation of the pipelined engine: newborns are written in the auxiliary matrix from the parents of the current
+    one, which are copied next to them; each thread evaluates and sorts its own chunk of newborns and merges it with
+    the runs of the other threads following a binary tree (thread 0 also merges the parents run); the matrices are
+    swapped at the end, so the step plays the role of generate + rank_generation + move_top.
+    The root merge of the tree is left pending: thread 0 runs it at the start of the next step while the other threads
+    copy the parents and generate the newborns whose two parents are already ranked (the others are put off until
+    they are), so nobody waits at the end of the step for the merge that only thread 0 can do; with
+    PIPELINE_BARRIER the other threads wait for it instead
+
+@param  pipe: Pipeline
+@param  pop: Population
+@param  cost_matrix: Pointer to memory that contains the symmetric node-travelling cost matrix
+@param  bestNum: Number of best elements (parents) that will produce the next generation
+@param  probCentile: Probability [0-100] of mutation occurence in the newly generated population element
+*/
+void pipelined_generation(Pipeline *pipe, Population *pop, int *cost_matrix, int bestNum, int probCentile){
+    int t,numSons,*swap,*swapAge;
+    unsigned long long *swapHash;
+    chrono::high_resolution_clock::time_point t_step;
+    chrono::duration<double> step_time;
+
+    numSons = pop->size-bestNum;
+    for (t=0; t<pipe->numThreads; ++t){
+        pipe->done[t].store(0, memory_order_relaxed);
+        pipe->work[t] = 0;
+    }
+
+    t_step = chrono::high_resolution_clock::now();
+
+#pragma omp parallel num_threads(pipe->numThreads)
+    {
+        int t,numThreads,numNodes,first,last,firstParent,lastParent,ranked,p,i,k,step,partner,end;
+        bool parentsCopied;
+        int *son;
+        const int *tours[EVALLANES];
+        vector<int> waiting;
+        chrono::high_resolution_clock::time_point t_start,t_wait;
+        chrono::duration<double> waited;
+
+        t_start = chrono::high_resolution_clock::now();
+        waited = chrono::duration<double>::zero();
+        t = omp_get_thread_num();
+        numThreads = omp_get_num_threads();
+        numNodes = pop->numNodes;
+
+        auto barrier = [&](){
+            if (pipelineMode == PIPELINE_BARRIER){
+                t_wait = chrono::high_resolution_clock::now();
+#pragma omp barrier
+                waited += chrono::high_resolution_clock::now()-t_wait;
+            }
+        };
+
+        // ROOT MERGE of the previous step (thread 0): it ranks the parents
+        if (t == 0)
+            pipeline_merge(pipe, pop, bestNum, bestNum);
+        barrier();
+
+        // GENERATION of the own chunk of newborns, and PARENTS copied next to them (their cost is set by thread 0), as
+        // soon as the parents are ranked: the newborns whose parents are not ranked yet are put off with their draws
+        first = bestNum+(long)numSons*t/numThreads;
+        last = bestNum+(long)numSons*(t+1)/numThreads;
+        firstParent = bestNum*t/numThreads;
+        lastParent = bestNum*(t+1)/numThreads;
+        parentsCopied = false;
+        auto copyParents = [&](int ranked){
+            if (!parentsCopied && ranked>=lastParent){
+                for (p=firstParent; p<lastParent; ++p){
+                    copy(row(pop, pipe->best[p]), row(pop, pipe->best[p])+numNodes, pop->generation_copy+(size_t)p*pop->stride);
+                    pop->hash_copy[p] = pop->hash[pipe->best[p]];
+                    pop->age_copy[p] = pop->age[pipe->best[p]]+1;
+                }
+                parentsCopied = true;
+            }
+        };
+        auto generateSon = [&](int i){
+            int parent1 = pipe->draws[i*2];
+            int parent2 = pipe->draws[i*2+1];
+            son = pop->generation_copy+(size_t)(bestNum+i)*pop->stride;
+            crossover(row(pop, pipe->best[parent1]), row(pop, pipe->best[parent2]), son, numNodes, probCentile, cost_matrix,
+                      max(parent1, parent2)*100 < bestNum*GPXELITE);
+            pop->age_copy[bestNum+i] = 0;
+        };
+
+        ranked = pipe->merged.load(memory_order_acquire);
+        copyParents(ranked);
+        for (i=first-bestNum; i<last-bestNum; ++i){
+            int parent1,parent2;
+            if (i<bestNum) // each best must generate at least one son
+                parent1 = i;
+            else
+                parent1 = randomBelow(bestNum);
+            do {    // two different parents
+                parent2 = randomBelow(bestNum);
+            } while(parent2==i);
+            pipe->draws[i*2] = parent1;
+            pipe->draws[i*2+1] = parent2;
+            if (max(parent1, parent2) >= ranked)
+                ranked = pipe->merged.load(memory_order_acquire);
+            if (max(parent1, parent2) < ranked)
+                generateSon(i);
+            else
+                waiting.push_back(i);
+        }
+        while (!waiting.empty() || !parentsCopied){
+            ranked = pipe->merged.load(memory_order_acquire);
+            copyParents(ranked);
+            k = 0;
+            for (int w : waiting){
+                if (max(pipe->draws[w*2], pipe->draws[w*2+1]) < ranked)
+                    generateSon(w);
+                else
+                    waiting[k++] = w;
+            }
+            if (k == (int)waiting.size() && (k>0 || !parentsCopied)){
+                t_wait = chrono::high_resolution_clock::now();
+                this_thread::yield();
+                waited += chrono::high_resolution_clock::now()-t_wait;
+            }
+            waiting.resize(k);
+        }
+        barrier();
+
+        // the costs of the previous generation are read by the root merge until it is over
+        if (t != 0){
+            t_wait = chrono::high_resolution_clock::now();
+            while (pipe->merged.load(memory_order_acquire) < bestNum)
+                this_thread::yield();
+            waited += chrono::high_resolution_clock::now()-t_wait;
+        }
+
+        // EVALUATION of the own chunk
+        for (i=first; i<last; i+=EVALLANES){
+            if (last-i >= EVALLANES){
+                for (k=0; k<EVALLANES; ++k)
+                    tours[k] = pop->generation_copy+(size_t)(i+k)*pop->stride;
+                evaluate_lanes<EVALLANES>(tours, cost_matrix, numNodes, pop->cost+i, pop->hash_copy+i);
+            }
+            else
+                for (k=i; k<last; ++k){
+                    tours[0] = pop->generation_copy+(size_t)k*pop->stride;
+                    evaluate_lanes<1>(tours, cost_matrix, numNodes, pop->cost+k, pop->hash_copy+k);
+                }
+        }
+        for (i=first; i<last; ++i)
+            pipe->rank_next[i] = i;
+        barrier();
+
+        // SORT of the own chunk (thread 0 merges it with the parents, unless it is the root merge)
+        if (first < last)
+            mergesort_help(pop->cost, pipe->rank_next, pipe->temp, first, last-1);
+        if (t == 0){
+            for (p=0; p<bestNum; ++p){
+                pipe->rank_next[p] = p;
+                pop->cost[p] = pipe->best_cost[p];
+            }
+            first = 0;
+            if (numThreads == 1)   // root merge (the pending one of this step is over)
+                pipe->mid = bestNum;
+            else if (bestNum>0 && last>bestNum)
+                merge(pop->cost, pipe->rank_next, pipe->temp, 0, bestNum-1, last-1);
+        }
+        barrier();
+
+        // MERGE TREE: thread t merges the runs of threads [t, t+2*step) once thread t+step is done; the last merge of
+        // thread 0 (the root) is left to the next step
+        for (step=1; step<numThreads; step*=2){
+            if (t%(2*step) != 0)
+                break;
+            partner = t+step;
+            if (partner >= numThreads)
+                continue;
+            if (t==0 && 2*step>=numThreads){
+                pipe->mid = bestNum+(long)numSons*partner/numThreads;
+                break;
+            }
+            t_wait = chrono::high_resolution_clock::now();
+            while (pipe->done[partner].load(memory_order_acquire) == 0)
+                this_thread::yield();
+            waited += chrono::high_resolution_clock::now()-t_wait;
+            end = bestNum+(long)numSons*min(partner+step, numThreads)/numThreads;
+            merge(pop->cost, pipe->rank_next, pipe->temp, first, bestNum+(long)numSons*partner/numThreads-1, end-1);
+        }
+        pipe->done[t].store(1, memory_order_release);
+
+        chrono::duration<double> busy = chrono::high_resolution_clock::now()-t_start;
+        pipe->work[t] = (busy-waited).count();
+    }
+    step_time = chrono::high_resolution_clock::now()-t_step;
+
+    // idle: waiting for the parents, partners and barriers, but also at the end of the parallel region
+    for (t=0; t<pipe->numThreads; ++t)
+        pipe->idle[t] = step_time.count()-pipe->work[t];
+
+    swap = pop->generation;
+    pop->generation = pop->generation_copy;
+    pop->generation_copy = swap;
+    swapHash = pop->hash;
+    pop->hash = pop->hash_copy;
+    pop->hash_copy = swapHash;
+    swapAge = pop->age;
+    pop->age = pop->age_copy;
+    pop->age_copy = swapAge;
+    swap = pipe->rank;
+    pipe->rank = pipe->rank_next;
+    pipe->rank_next = swap;
+    pop->ranked = bestNum;
+
+    // the root merge is pending
+    pipe->nextA = 0;
+    pipe->nextB = pipe->mid;
+    pipe->merged.store(0, memory_order_relaxed);
+}
+
+#endif
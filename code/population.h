@@ -0,0 +1,125 @@
+/**
+population.h
+Purpose: Population container for genetic_utils.h: permutation rows aligned to the cache line with the row stride
+    padded to a whole number of cache lines (so no two rows share a line, unless compactRows is set), plus one array
+    per row attribute
+
+@author Danilo Franco
+*/
+
+#ifndef POPULATION_H
+#define POPULATION_H
+
+#include <set>
+
+#include "memory_utils.h"
+
+#define ROWPAD (CACHELINE/sizeof(int))     // row stride granularity (ints)
+
+bool compactRows = false;   // rows packed one after the other (no padding) when memory is short
+
+/**
+Population of permutations (structure of arrays); rows and attributes are double buffered so that move_top can
+    rearrange them without moving the whole matrix
+*/
+struct Population {
+    int size;                       // number of rows (population)
+    int numNodes;                   // elements of a permutation
+    int stride;                     // ints between the start of two consecutive rows (>= numNodes)
+    int *generation;                // size*stride permutation matrix for the current iteration
+    int *generation_copy;           // auxiliary permutation matrix
+    int *cost;                      // travelling cost of each row (after ranking: cost of the i-th best)
+    unsigned long long *hash;       // rotation/direction invariant hash of each row
+    unsigned long long *hash_copy;
+    int *age;                       // generations each row survived as a parent (0 for the newborns)
+    int *age_copy;
+    int ranked;                     // leading rows whose cost and hash are up to date and sorted (the parents)
+};
+
+/**
+Allocates a population
+
+@param  population: Number of rows
+@param  numNodes: Number of travelling-nodes in the problem
+
+@return     Pointer to the new population
+*/
+Population* newPopulation(int population, int numNodes){
+    Population *pop = new Population;
+    pop->size = population;
+    pop->numNodes = numNodes;
+    pop->stride = compactRows ? numNodes : (numNodes+ROWPAD-1)/ROWPAD*ROWPAD;
+    pop->generation = allocLarge<int>((size_t)population*pop->stride);
+    pop->generation_copy = allocLarge<int>((size_t)population*pop->stride);
+    pop->cost = allocAligned<int>(population);
+    pop->hash = allocAligned<unsigned long long>(population);
+    pop->hash_copy = allocAligned<unsigned long long>(population);
+    pop->age = allocAligned<int>(population);
+    pop->age_copy = allocAligned<int>(population);
+    fill(pop->age, pop->age+population, 0);
+    pop->ranked = 0;
+    return pop;
+}
+
+/**
+Releases a population obtained with newPopulation
+
+@param  pop: Population to be released
+*/
+void deletePopulation(Population *pop){
+    freeLarge(pop->generation, (size_t)pop->size*pop->stride);
+    freeLarge(pop->generation_copy, (size_t)pop->size*pop->stride);
+    freeAligned(pop->cost);
+    freeAligned(pop->hash);
+    freeAligned(pop->hash_copy);
+    freeAligned(pop->age);
+    freeAligned(pop->age_copy);
+    delete pop;
+}
+
+/**
+Returns the i-th row of the current permutation matrix
+
+@param  pop: Population
+@param  i: Row index
+*/
+inline int* row(Population *pop, int i){
+    return pop->generation+(size_t)i*pop->stride;
+}
+
+/**
+Hash of the undirected edge (a,b) (splitmix64 finalizer)
+*/
+inline unsigned long long edgeHash(int a, int b){
+    unsigned long long x;
+    x = a<b ? ((unsigned long long)a<<32)|(unsigned)b : ((unsigned long long)b<<32)|(unsigned)a;
+    x = (x^(x>>30))*0xbf58476d1ce4e5b9ULL;
+    x = (x^(x>>27))*0x94d049bb133111ebULL;
+    return x^(x>>31);
+}
+
+/**
+Hash of a permutation as the sum of its (cyclic) edge hashes: equal for rotated or reversed tours
+
+@param  tour: Pointer to the permutation
+@param  numNodes: Number of travelling-nodes in the problem
+*/
+unsigned long long tourHash(const int *tour, int numNodes){
+    unsigned long long h = edgeHash(tour[numNodes-1], tour[0]);
+    for (int j=0; j<numNodes-1; ++j)
+        h += edgeHash(tour[j], tour[j+1]);
+    return h;
+}
+
+/**
+Counts the distinct hashes among the first rows (diversity of the parents)
+
+@param  hash: Pointer to the hash array
+@param  len: Number of rows to be checked
+*/
+int countDistinct(const unsigned long long *hash, int len){
+    set<unsigned long long> distinct(hash, hash+len);
+    return distinct.size();
+}
+
+#endif
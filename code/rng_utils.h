@@ -0,0 +1,144 @@
+/**
+rng_utils.h
+Purpose: Seedable random number generators (reproducible streams independent from rand()) and the bulk generator of
+    the genetic operators: each thread owns RNGLANES xoshiro256** generators advanced together (the refill loop is
+    vectorised by the compiler) that fill a buffer of random words, from which bounded integers are drawn with
+    Lemire's multiply-shift method (unbiased, no division in the common case)
+
+@author Danilo Franco
+*/
+
+#ifndef RNG_UTILS_H
+#define RNG_UTILS_H
+
+#include <atomic>
+
+#define RNGLANES 8          // xoshiro256** generators of each thread, advanced in lockstep
+#define RNGBUFFER 512       // random 32-bit words produced by each refill (multiple of 2*RNGLANES)
+
+/**
+SplitMix64: advances the state and returns the next 64 random bits; also used to derive independent seeds
+    (e.g. one stream per matrix row from a single seed)
+
+@param  state: Generator state (updated)
+
+@return     Random 64 bits
+*/
+inline unsigned long long splitmix64(unsigned long long &state){
+    unsigned long long z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+    z = (z^(z>>27))*0x94d049bb133111ebULL;
+    return z^(z>>31);
+}
+
+/**
+Returns the starting state of the stream-th independent stream of a seed
+
+@param  seed: Global seed
+@param  stream: Stream index
+*/
+inline unsigned long long streamState(unsigned long long seed, unsigned long long stream){
+    unsigned long long state = seed^(stream*0xd1b54a32d192ed03ULL);
+    splitmix64(state);
+    return state;
+}
+
+/////////////////////// BULK GENERATOR ///////////////////////
+/**
+Per-thread bulk generator: lane states (structure of arrays) and the buffer of pre-generated words
+*/
+struct BulkRandom {
+    unsigned long long s[4][RNGLANES];
+    unsigned buffer[RNGBUFFER];
+    int next;               // first unused word of the buffer
+    unsigned epoch;         // seeding the thread state belongs to
+};
+
+unsigned long long randomSeed = 0;
+unsigned randomEpoch = 1;                       // increased by seedRandom: thread states are seeded again on next use
+atomic<unsigned long long> randomStreams(0);    // streams handed out to threads since the last seedRandom
+
+/**
+Seeds the bulk generators of every thread (must be called outside of parallel sections)
+
+@param  seed: Global seed (each thread gets an independent stream of it)
+*/
+void seedRandom(unsigned long long seed){
+    randomSeed = seed;
+    randomStreams = 0;
+    ++randomEpoch;
+}
+
+/**
+Refills the buffer: RNGBUFFER/(2*RNGLANES) xoshiro256** steps of every lane, each giving two 32-bit words
+
+@param  g: Bulk generator
+*/
+void refillRandom(BulkRandom &g){
+    int i,k;
+    unsigned long long result,t;
+    for (i=0; i<RNGBUFFER; i+=2*RNGLANES){
+        for (k=0; k<RNGLANES; ++k){
+            result = g.s[1][k]*5;
+            result = ((result<<7)|(result>>57))*9;
+            t = g.s[1][k]<<17;
+            g.s[2][k] ^= g.s[0][k];
+            g.s[3][k] ^= g.s[1][k];
+            g.s[1][k] ^= g.s[2][k];
+            g.s[0][k] ^= g.s[3][k];
+            g.s[2][k] ^= t;
+            g.s[3][k] = (g.s[3][k]<<45)|(g.s[3][k]>>19);
+            g.buffer[i+k] = (unsigned)result;
+            g.buffer[i+RNGLANES+k] = (unsigned)(result>>32);
+        }
+    }
+    g.next = 0;
+}
+
+/**
+Returns the bulk generator of the calling thread, seeding it on first use (and after each seedRandom)
+*/
+inline BulkRandom& threadRandom(){
+    static thread_local BulkRandom g;
+    if (g.epoch != randomEpoch){
+        unsigned long long state = streamState(randomSeed, randomStreams++);
+        for (int j=0; j<4; ++j)
+            for (int k=0; k<RNGLANES; ++k)
+                g.s[j][k] = splitmix64(state);
+        g.next = RNGBUFFER;
+        g.epoch = randomEpoch;
+    }
+    return g;
+}
+
+/**
+Returns 32 random bits from the buffer of the calling thread
+*/
+inline unsigned random32(){
+    BulkRandom &g = threadRandom();
+    if (g.next == RNGBUFFER)
+        refillRandom(g);
+    return g.buffer[g.next++];
+}
+
+/**
+Returns an unbiased random integer in [0, bound) (Lemire's method: the rejection threshold, which needs a division,
+    is only computed in the rare case in which the low half of the product falls below bound)
+
+@param  bound: Number of possible values (> 0)
+*/
+inline unsigned randomBelow(unsigned bound){
+    unsigned long long m = (unsigned long long)random32()*bound;
+    unsigned low = (unsigned)m;
+    if (low < bound){
+        unsigned threshold = -bound%bound;
+        while (low < threshold){
+            m = (unsigned long long)random32()*bound;
+            low = (unsigned)m;
+        }
+    }
+    return m>>32;
+}
+/////////////////////// END BULK GENERATOR ///////////////////////
+
+#endif
@@ -0,0 +1,243 @@
+/**
+sa_engine.h
+Purpose: Parallel tempering simulated annealing engine, alternative to the genetic algorithm of genetic_engine.h: one
+    replica per thread at its own temperature of a geometric ladder, 2-opt and swap moves towards the nearest neighbors
+    with O(1) cost deltas from the cost matrix, exchanges between adjacent temperatures after each round and the whole
+    ladder cooled down along the rounds
+
+@author Danilo Franco
+*/
+
+#ifndef SA_ENGINE_H
+#define SA_ENGINE_H
+
+#include <vector>
+#include <cmath>        // exp, pow
+#include <chrono>
+
+#include "instance_utils.h"
+#include "genetic_engine.h"
+#include "local_search.h"
+#include "ils_engine.h"     // ils_startTour
+
+#define SAMOVES 10          // moves tried by each replica in a round, per node
+#define SASWAPS 20          // percentage of swap moves (2-opt moves otherwise)
+#define SASAMPLES 1000      // random moves sampled to set the highest temperature
+#define SALADDER 0.01       // ratio between the coldest and the hottest temperature of the ladder
+#define SAFINAL 0.001       // cooling of the whole ladder at the last round
+#define SAMINNODES 5        // smaller instances are left to the genetic algorithm
+
+/**
+Replica of the parallel tempering: tour (with the LocalTour helpers) and best tour met at the end of a round
+*/
+struct SaReplica {
+    LocalTour lt;
+    vector<int> best;
+    long long bestCost;
+    long long accepted;
+};
+
+/**
+Cost change of exchanging the positions of two nodes
+
+@param  lt: Tour
+@param  u: First node
+@param  v: Second node
+*/
+inline int sa_swapDelta(const LocalTour &lt, int u, int v){
+    int pu,nu,pv,nv;
+    pu = ls_pred(lt, u);
+    nu = ls_succ(lt, u);
+    pv = ls_pred(lt, v);
+    nv = ls_succ(lt, v);
+    if (nu == v)
+        return ls_cost(lt, pu, v)+ls_cost(lt, u, nv)-ls_cost(lt, pu, u)-ls_cost(lt, v, nv);
+    if (nv == u)
+        return ls_cost(lt, pv, u)+ls_cost(lt, v, nu)-ls_cost(lt, pv, v)-ls_cost(lt, u, nu);
+    return ls_cost(lt, pu, v)+ls_cost(lt, v, nu)+ls_cost(lt, pv, u)+ls_cost(lt, u, nv)
+          -ls_cost(lt, pu, u)-ls_cost(lt, u, nu)-ls_cost(lt, pv, v)-ls_cost(lt, v, nv);
+}
+
+/**
+Tries one random move: a random node a is joined to one of its neighbors c, either by the 2-opt move that replaces
+    (a,succ(a)) and (c,succ(c)) or by swapping succ(a) and c; the move is accepted with the Metropolis rule
+
+@param  lt: Tour
+@param  temperature: Current temperature of the replica
+
+@return     True iff the move has been accepted
+*/
+bool sa_move(LocalTour &lt, double temperature){
+    int a,b,c,d,k,delta;
+    bool swapMove;
+
+    a = randomBelow(lt.numNodes);
+    c = lt.neighbors[(size_t)a*lt.numNeighbors+randomBelow(lt.numNeighbors)];
+    b = ls_succ(lt, a);
+    if (c == b)
+        return false;
+    swapMove = (int)randomBelow(100) < SASWAPS;
+    if (swapMove)
+        delta = sa_swapDelta(lt, b, c);
+    else {
+        d = ls_succ(lt, c);
+        if (d == a)
+            return false;
+        delta = ls_cost(lt, a, c)+ls_cost(lt, b, d)-ls_cost(lt, a, b)-ls_cost(lt, c, d);
+    }
+    if (delta>0 && random32()/4294967296.0 >= exp(-delta/temperature))
+        return false;
+
+    if (swapMove){
+        k = lt.pos[b];
+        lt.tour[k] = c;
+        lt.tour[lt.pos[c]] = b;
+        lt.pos[b] = lt.pos[c];
+        lt.pos[c] = k;
+    }
+    else
+        ls_reverse(lt, lt.pos[b], lt.pos[c]);
+    lt.cost += delta;
+    return true;
+}
+
+/**
+Finds and returns the solution for the tsp with parallel tempering: one replica per thread
+
+@param  me: Index of the current executing node in the cluster (0 when not running under MPI)
+@param  numInstances: Amount of nodes currently working on finding the solution (1 when not running under MPI)
+@param  numThreads: Number of processing elements that are due to work on each parallel section (number of replicas)
+@param  inst: Instance (its neighbor lists are computed if missing)
+@param  maxIt: Number of rounds (SAMOVES*numNodes moves per replica, then exchanges)
+@param  earlyStopRounds: number of latest rounds from which the standard deviation of the best cost is computed
+            in order to establish convergence
+@param  earlyStopParam: Comparison parameter for early stopping
+
+@return     Pointer to the best nodes permutation (integer index) + solution cost + convergence boolean + rounds count
+            (under MPI, where every node runs its own ladder, the best tour among the nodes)
+*/
+int* sa_tsp(int me, int numInstances, int numThreads, Instance *inst, int maxIt, int earlyStopRounds, double earlyStopParam){
+    int numNodes,numReplicas,r,k,t,best,swaps,tries,*neighbors,*solution;
+    vector<SaReplica> replicas(numThreads);
+    vector<int> start, slot;            // slot[k]: replica at the k-th temperature (hottest first)
+    vector<double> ladder, lastRounds(earlyStopRounds);
+    double hottest,scale,sum,exponent;
+    long long bestCost;
+    LocalTour sample;
+    chrono::high_resolution_clock::time_point t_start, t_end, t_run;
+    chrono::duration<double> exec_time;
+
+    t_run = chrono::high_resolution_clock::now();
+    numNodes = inst->numNodes;
+    numReplicas = numThreads;
+    neighbors = getNeighbors(inst, numThreads);
+    if (gapLimit >= 0)
+        lowerBound = heldKarpBound(inst->cost_matrix, numNodes, numThreads);
+
+    // HOTTEST TEMPERATURE: average uphill move from the prior tour (warm start) or the nearest neighbour tour
+    start.resize(numNodes);
+    if (!warmTour(numNodes, me, start.data()))
+        ils_startTour(inst->cost_matrix, numNodes, neighbors, inst->numNeighbors, randomBelow(numNodes), start.data());
+    initLocalTour(sample, start.data(), numNodes, inst->cost_matrix, neighbors, inst->numNeighbors);
+    sum = 0;
+    tries = 0;
+    for (k=0; k<SASAMPLES; ++k){
+        long long before = sample.cost;
+        if (sa_move(sample, 1e300) && sample.cost>before){
+            sum += sample.cost-before;
+            ++tries;
+        }
+    }
+    hottest = tries>0 ? sum/tries : 1;
+
+    ladder.resize(numReplicas);
+    slot.resize(numReplicas);
+    for (k=0; k<numReplicas; ++k){
+        ladder[k] = numReplicas>1 ? hottest*pow(SALADDER, (double)k/(numReplicas-1)) : hottest*SALADDER;
+        slot[k] = k;
+        initLocalTour(replicas[k].lt, start.data(), numNodes, inst->cost_matrix, neighbors, inst->numNeighbors);
+        replicas[k].best = start;
+        replicas[k].bestCost = replicas[k].lt.cost;
+    }
+
+    solution = new int[numNodes+3];
+    solution[numNodes+1] = 0; //not converged
+    for (r=1; r<=maxIt; ++r){
+        t_start = chrono::high_resolution_clock::now();
+        scale = pow(SAFINAL, (double)(r-1)/maxIt);
+
+        // ANNEALING of every replica at its temperature
+        parallel_for(numThreads, 0, numReplicas, [&](int k){
+            SaReplica &rep = replicas[slot[k]];
+            double temperature = ladder[k]*scale;
+            rep.accepted = 0;
+            for (long m=0; m<(long)SAMOVES*numNodes; ++m)
+                rep.accepted += sa_move(rep.lt, temperature);
+            if (rep.lt.cost < rep.bestCost){
+                rep.best = rep.lt.tour;
+                rep.bestCost = rep.lt.cost;
+            }
+        });
+
+        // EXCHANGES between adjacent temperatures (even pairs on even rounds, odd pairs on odd ones)
+        swaps = 0;
+        for (k=r%2; k+1<numReplicas; k+=2){
+            exponent = (1/(ladder[k]*scale)-1/(ladder[k+1]*scale))*(replicas[slot[k]].lt.cost-replicas[slot[k+1]].lt.cost);
+            if (exponent>=0 || random32()/4294967296.0 < exp(exponent)){
+                t = slot[k];
+                slot[k] = slot[k+1];
+                slot[k+1] = t;
+                ++swaps;
+            }
+        }
+
+        bestCost = replicas[0].bestCost;
+        for (k=1; k<numReplicas; ++k)
+            bestCost = min(bestCost, replicas[k].bestCost);
+        t_end = chrono::high_resolution_clock::now();
+        exec_time = t_end-t_start;
+#ifdef PRINTSCOST
+        printf("#%d\n\tbest %lld, coldest %lld, exchanges %d: %f\n",r,bestCost,replicas[slot[numReplicas-1]].lt.cost,swaps,exec_time.count());
+#endif
+#ifdef DETAILEDCOSTS
+        for (k=0; k<numReplicas; ++k)
+            asyncPrintf(generationFile,"%d %d %lld %f\n",numNodes,k,replicas[slot[k]].lt.cost,exec_time.count());
+#endif
+
+        lastRounds[(r-1)%earlyStopRounds] = bestCost;
+        if (targetReached(bestCost) ||
+            (r>=earlyStopRounds && stdDev(lastRounds.data(), earlyStopRounds)<=earlyStopParam)){
+            solution[numNodes+1] = 1; //converged
+            break;
+        }
+        exec_time = t_end-t_run;
+        if (timeLimit>=0 && exec_time.count()>=timeLimit)
+            break;
+    }
+
+    best = 0;
+    for (k=1; k<numReplicas; ++k)
+        if (replicas[k].bestCost < replicas[best].bestCost)
+            best = k;
+    copy(replicas[best].best.begin(), replicas[best].best.end(), solution);
+    solution[numNodes] = replicas[best].bestCost;
+    solution[numNodes+2] = min(r, maxIt);
+
+#ifdef MPI_VERSION
+    // best tour among the nodes (the convergence flag and the rounds stay the local ones)
+    if (numInstances > 1){
+        int *recv_buff = new int[numNodes+1];
+        MPI_Op op;
+        MPI_Op_create((MPI_User_function *)minimumCost, 1, &op);
+        MPI_Allreduce(solution, recv_buff, numNodes+1, MPI_INT, op, MPI_COMM_WORLD);
+        MPI_Op_free(&op);
+        copy(recv_buff, recv_buff+numNodes+1, solution);
+        delete[] recv_buff;
+    }
+#else
+    (void)numInstances;     // always 1 without MPI
+#endif
+    return solution;
+}
+
+#endif
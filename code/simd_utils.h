@@ -0,0 +1,146 @@
+/**
+simd_utils.h
+Purpose: Vector kernels for genetic_utils.h, selected at runtime according to the instruction sets of the processor
+    (the executables are built without -march flags): AVX-512, AVX2 or plain scalar code
+
+@author Danilo Franco
+*/
+
+#ifndef SIMD_UTILS_H
+#define SIMD_UTILS_H
+
+#include <immintrin.h>
+
+#define SIMD_SCALAR 0
+#define SIMD_AVX2 1
+#define SIMD_AVX512 2
+
+int compactTable[256][8];   // AVX2 compaction: permutation moving the lanes selected by each 8-bit mask to the front
+
+/**
+Detects the widest supported instruction set (and builds the AVX2 compaction table)
+
+@return     SIMD_AVX512, SIMD_AVX2 or SIMD_SCALAR
+*/
+int detectSimd(){
+    int m,k,lane;
+    for (m=0; m<256; ++m){
+        k = 0;
+        for (lane=0; lane<8; ++lane)
+            if (m & (1<<lane))
+                compactTable[m][k++] = lane;
+        while (k<8)
+            compactTable[m][k++] = 0;
+    }
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+    return SIMD_SCALAR;
+}
+
+int simdLevel = detectSimd();
+
+/**
+Marks a node in a bitmap
+
+@param  bits: Pointer to the bitmap (one bit per node)
+@param  node: Node to be marked
+*/
+inline void setBit(unsigned *bits, int node){
+    bits[node>>5] |= 1u<<(node&31);
+}
+
+/**
+Copies the nodes of src that are not marked in the bitmap, in order (scalar version, branchless)
+
+@param  src: Pointer to the nodes to be filtered
+@param  len: Number of nodes in src
+@param  taken: Bitmap of the nodes to be skipped
+@param  dst: Pointer to the output (at least room elements)
+@param  room: Number of elements that may be written in dst
+
+@return     Number of nodes written
+*/
+int compact_untaken_scalar(const int *src, int len, const unsigned *taken, int *dst, int room){
+    int i,out,elem;
+    out = 0;
+    for (i=0; i<len && out<room; ++i){
+        elem = src[i];
+        dst[out] = elem;
+        out += !((taken[elem>>5]>>(elem&31))&1);
+    }
+    return out;
+}
+
+/**
+AVX2 version of compact_untaken_scalar: membership of 8 nodes at a time through a gather on the bitmap, survivors
+    moved to the front with a permutation from compactTable (a full vector is stored, so only while 8 more fit)
+*/
+__attribute__((target("avx2")))
+int compact_untaken_avx2(const int *src, int len, const unsigned *taken, int *dst, int room){
+    int i,out,mask;
+    __m256i nodes,words,bits,one,low;
+
+    one = _mm256_set1_epi32(1);
+    low = _mm256_set1_epi32(31);
+    out = 0;
+    for (i=0; i+8<=len && out+8<=room; i+=8){
+        nodes = _mm256_loadu_si256((const __m256i*)(src+i));
+        words = _mm256_i32gather_epi32((const int*)taken, _mm256_srli_epi32(nodes, 5), 4);
+        bits = _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_and_si256(nodes, low)), one);
+        mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(bits, _mm256_setzero_si256())));
+        _mm256_storeu_si256((__m256i*)(dst+out),
+                            _mm256_permutevar8x32_epi32(nodes, _mm256_loadu_si256((const __m256i*)compactTable[mask])));
+        out += __builtin_popcount(mask);
+    }
+    return out+compact_untaken_scalar(src+i, len-i, taken, dst+out, room-out);
+}
+
+/**
+AVX-512 version of compact_untaken_scalar: membership of 16 nodes at a time through a gather on the bitmap,
+    survivors written with a compressing store (VPCOMPRESSD), which never writes past them
+*/
+__attribute__((target("avx512f")))
+int compact_untaken_avx512(const int *src, int len, const unsigned *taken, int *dst, int room){
+    int i,out;
+    __mmask16 mask;
+    __m512i nodes,words,bits,one,low;
+
+    one = _mm512_set1_epi32(1);
+    low = _mm512_set1_epi32(31);
+    out = 0;
+    for (i=0; i+16<=len && out<room; i+=16){
+        nodes = _mm512_loadu_si512((const void*)(src+i));
+        words = _mm512_i32gather_epi32(_mm512_srli_epi32(nodes, 5), (const void*)taken, 4);
+        bits = _mm512_srlv_epi32(words, _mm512_and_si512(nodes, low));
+        mask = _mm512_testn_epi32_mask(bits, one);
+        if (out+__builtin_popcount(mask) > room)
+            break;
+        _mm512_mask_compressstoreu_epi32((void*)(dst+out), mask, nodes);
+        out += __builtin_popcount(mask);
+    }
+    return out+compact_untaken_scalar(src+i, len-i, taken, dst+out, room-out);
+}
+
+/**
+Copies the nodes of src that are not marked in the bitmap, in order, with the widest available kernel
+
+@param  src: Pointer to the nodes to be filtered
+@param  len: Number of nodes in src
+@param  taken: Bitmap of the nodes to be skipped
+@param  dst: Pointer to the output (at least room elements)
+@param  room: Number of elements that may be written in dst
+
+@return     Number of nodes written
+*/
+inline int compact_untaken(const int *src, int len, const unsigned *taken, int *dst, int room){
+    if (simdLevel == SIMD_AVX512)
+        return compact_untaken_avx512(src, len, taken, dst, room);
+    if (simdLevel == SIMD_AVX2)
+        return compact_untaken_avx2(src, len, taken, dst, room);
+    return compact_untaken_scalar(src, len, taken, dst, room);
+}
+
+#endif
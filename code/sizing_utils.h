@@ -0,0 +1,169 @@
+/**
+sizing_utils.h
+Purpose: Population sizing and memory budgeting for the gen_tsp executables: the population can be derived from a
+    target winning probability (the Compute_Pop_Size formula of the launch scripts) and the memory needed by the run is
+    estimated before the instance is loaded, so that a run that cannot fit is shrunk or stopped instead of swapping
+
+@author Danilo Franco
+*/
+
+#ifndef SIZING_UTILS_H
+#define SIZING_UTILS_H
+
+#include <cmath>        // log, exp, pow
+#include <unistd.h>     // sysconf
+
+#include "solver.h"
+
+#define DEFAULTPOPPROB 0.1      // target winning probability when the population is sized automatically
+#define MEMFRACTION 0.9         // share of the physical memory of the machine available to its processes
+#define MEBI (1024.0*1024.0)
+
+/**
+Population that contains every edge of the instance with the given probability (Compute_Pop_Size of the launch
+    scripts: log(1-prob^(1/numNodes)) / log((numNodes-3)/(numNodes-1)), truncated)
+
+@param  numNodes: Number of travelling-nodes in the problem
+@param  prob: Target probability [0-1]
+*/
+int populationForProbability(int numNodes, double prob){
+    double size;
+    if (numNodes <= 3)
+        return 1;
+    size = log(1-exp(log(prob)/numNodes))/log((numNodes-3.0)/(numNodes-1.0));
+    return size<INT_MAX ? (int)size : INT_MAX;
+}
+
+/**
+Inverse of populationForProbability
+
+@param  numNodes: Number of travelling-nodes in the problem
+@param  population: Number of rows
+*/
+double probabilityForPopulation(int numNodes, int population){
+    if (numNodes <= 3)
+        return 1;
+    return pow(1-pow((numNodes-3.0)/(numNodes-1.0), population), numNodes);
+}
+
+/**
+Bytes of memory needed by a run apart from the rows of the population: cost matrix, neighbor lists, per-thread
+    crossover buffers and (decomposition mode) the sub-matrices being solved at the same time
+
+@param  numNodes: Number of travelling-nodes in the problem
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+*/
+double fixedMemory(int numNodes, int numThreads){
+    double bytes,clusterNodes;
+    bytes = (double)numNodes*numNodes*sizeof(int)+(double)numNodes*NUMNEIGHBORS*sizeof(int);
+    bytes += (double)numThreads*numNodes*(6*sizeof(int)+sizeof(long long));
+    if (decomposeClusters > 1){
+        clusterNodes = (double)numNodes/decomposeClusters;
+        bytes += min(numThreads, decomposeClusters)*clusterNodes*clusterNodes*sizeof(int);
+    }
+    return bytes;
+}
+
+/**
+Bytes of memory needed by each row of the population: two permutation matrices, cost, hashes and ages, ranking and
+    mergesort arrays, pipeline rankings
+
+@param  numNodes: Number of travelling-nodes in the problem
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+@param  compact: Whether the rows are not padded
+*/
+double rowMemory(int numNodes, int numThreads, bool compact){
+    double rowNodes,bytes;
+    rowNodes = compact ? numNodes : (numNodes+ROWPAD-1)/ROWPAD*ROWPAD;
+    if (decomposeClusters > 1)      // one population per cluster being solved
+        rowNodes = min(numThreads, decomposeClusters)*ceil((double)numNodes/decomposeClusters);
+    bytes = 2*rowNodes*sizeof(int);
+    bytes += sizeof(int)+2*sizeof(unsigned long long)+2*sizeof(int);
+    bytes += 3*sizeof(int);
+    if (pipelineMode != PIPELINE_OFF)
+        bytes += 4*sizeof(int);
+    return bytes;
+}
+
+/**
+Memory available to this process: --mem-budget (MiB per process), otherwise --node-mem-budget (MiB per machine) or
+    MEMFRACTION of the physical memory, shared among the processes started on the machine
+
+@param  argc: Number of command line arguments
+@param  argv: Command line arguments
+
+@return     Budget in bytes (negative if an option is invalid)
+*/
+double memoryBudget(int argc, char *argv[]){
+    const char *val;
+    val = getOption(argc, argv, FIRSTOPTION, "--mem-budget");
+    if (val != NULL)
+        return atof(val)>0 ? atof(val)*MEBI : -1;
+    val = getOption(argc, argv, FIRSTOPTION, "--node-mem-budget");
+    if (val != NULL)
+        return atof(val)>0 ? atof(val)*MEBI/launcherLocalSize() : -1;
+    return MEMFRACTION*sysconf(_SC_PHYS_PAGES)*(double)sysconf(_SC_PAGESIZE)/launcherLocalSize();
+}
+
+/**
+Sizes the population and checks that the run fits in the memory budget (before the instance is loaded): a population
+    of 0 is derived from --pop-prob (default DEFAULTPOPPROB); if the rows do not fit they are packed (compactRows) and
+    then the population is reduced, with a warning; the run is refused when not even minPopulation rows fit
+
+@param  numNodes: Number of travelling-nodes in the problem
+@param  population: Number of rows (0: automatic), written with the chosen one
+@param  minPopulation: Smallest acceptable population
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+@param  argc: Number of command line arguments
+@param  argv: Command line arguments
+
+@return     False (with the estimate on the standard error) if the run cannot fit or an option is invalid
+*/
+bool sizePopulation(int numNodes, int &population, int minPopulation, int numThreads, int argc, char *argv[]){
+    const char *val;
+    double prob,budget,fixed,perRow,fitting;
+    int rows;
+
+    prob = DEFAULTPOPPROB;
+    val = getOption(argc, argv, FIRSTOPTION, "--pop-prob");
+    if (val != NULL){
+        prob = atof(val);
+        if (prob<=0 || prob>=1){
+            cerr << "Invalid options!" << endl;
+            return false;
+        }
+    }
+    budget = memoryBudget(argc, argv);
+    if (budget < 0){
+        cerr << "Invalid options!" << endl;
+        return false;
+    }
+    if (population == 0)
+        population = max(populationForProbability(numNodes, prob), minPopulation);
+
+    fixed = fixedMemory(numNodes, numThreads);
+    perRow = rowMemory(numNodes, numThreads, compactRows);
+    rows = solverEngine!=ENGINE_GA && numNodes>EXACTBB ? 0 : population;   // the other engines keep no population
+    if (fixed+perRow*rows <= budget)
+        return true;
+
+    if (rows > 0){
+        compactRows = true;
+        perRow = rowMemory(numNodes, numThreads, true);
+        fitting = (budget-fixed)/perRow;
+        if (fitting >= population)
+            return true;
+        if (fitting >= minPopulation){
+            fprintf(stderr, "Population reduced from %d to %d to fit in %.0f MiB (winning probability %g)\n",
+                    population, (int)fitting, budget/MEBI, probabilityForPopulation(numNodes, (int)fitting));
+            population = fitting;
+            return true;
+        }
+    }
+    fprintf(stderr, "Out of memory: %.0f MiB needed (%.0f MiB instance, %.0f MiB for %d rows), %.0f MiB available"
+                    " (try --decompose or --engine ils)\n",
+            (fixed+perRow*rows)/MEBI, fixed/MEBI, perRow*rows/MEBI, rows, budget/MEBI);
+    return false;
+}
+
+#endif
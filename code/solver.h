@@ -0,0 +1,104 @@
+/**
+solver.h
+Purpose: Solver selection for the gen_tsp executables: reads the engine settings from the command line and runs the
+    chosen engine (genetic algorithm of genetic_engine.h, iterated local search of ils_engine.h or parallel tempering
+    of sa_engine.h) on the instance
+
+@author Danilo Franco
+*/
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "instance_utils.h"
+#include "genetic_engine.h"
+#include "ils_engine.h"
+#include "sa_engine.h"
+
+#define ENGINE_GA 0
+#define ENGINE_ILS 1
+#define ENGINE_SA 2
+
+int solverEngine = ENGINE_GA;
+const char *warmStartFiles = NULL;  // comma separated prior tours (--warm-start)
+const char *saveTourFile = NULL;    // where the best tour is written (--save-tour)
+
+/**
+Reads the optional settings of genetic_engine.h (setEngineOptions) and the engine choice:
+    --engine ga|ils|sa   genetic algorithm (default), one iterated local search chain per thread or parallel
+        tempering with one simulated annealing replica per thread (ils and sa not with --decompose)
+    --warm-start file[,file]   start from prior tours of the instance (warm_start.h)
+    --save-tour file   write the best tour found (node 0 under MPI), in the format read by --warm-start
+
+@param  argc: Number of command line arguments
+@param  argv: Command line arguments
+
+@return     False if an option has an invalid value
+*/
+bool setSolverOptions(int argc, char *argv[]){
+    const char *val;
+
+    if (!setEngineOptions(argc, argv))
+        return false;
+
+    val = getOption(argc, argv, FIRSTOPTION, "--engine");
+    if (val != NULL){
+        if (strcmp(val, "ga")==0)
+            solverEngine = ENGINE_GA;
+        else if (strcmp(val, "ils")==0)
+            solverEngine = ENGINE_ILS;
+        else if (strcmp(val, "sa")==0)
+            solverEngine = ENGINE_SA;
+        else
+            return false;
+    }
+
+    // the clusters of a decomposition are solved by the genetic algorithm
+    if (decomposeClusters>1 && solverEngine!=ENGINE_GA)
+        return false;
+
+    // cost updates are applied by the genetic algorithm only, and not to the clusters of a decomposition
+    if (dynamicCosts && (solverEngine!=ENGINE_GA || decomposeClusters>1))
+        return false;
+
+    warmStartFiles = getOption(argc, argv, FIRSTOPTION, "--warm-start");
+    saveTourFile = getOption(argc, argv, FIRSTOPTION, "--save-tour");
+    return true;
+}
+
+/**
+Finds and returns the solution for the tsp with the selected engine (instances solved exactly by genetic_tsp, and
+    those too small for the other engines' moves, always go to the genetic algorithm), warm started from the prior
+    tours if any
+
+@param  me: Index of the current executing node in the cluster (0 when not running under MPI)
+@param  numInstances: Amount of nodes currently working on finding the solution (1 when not running under MPI)
+@param  numThreads: Number of processing elements that are due to work on each parallel section
+@param  inst: Instance
+@param  population, top, maxIt, mutatProb, earlyStopRounds, earlyStopParam: settings of genetic_tsp (the iterated
+            local search and the parallel tempering use maxIt as their number of rounds and the early stop settings on
+            the rounds)
+
+@return     Pointer to the found nodes permutation (integer index) + solution cost + convergence boolean + iterations count
+*/
+int* solve_tsp(int me, int numInstances, int numThreads, Instance *inst, int population, double top, int maxIt, double mutatProb, int earlyStopRounds, double earlyStopParam){
+    int numNodes = inst->numNodes;
+    bool exact = exactSmall && numNodes<=EXACTBB;
+    int *solution;
+
+    if (warmStartFiles != NULL)
+        loadWarmTours(warmStartFiles, numNodes);
+
+    if (solverEngine==ENGINE_ILS && numNodes>=ILSMINNODES && !exact)
+        solution = ils_tsp(me, numInstances, numThreads, inst, maxIt, earlyStopRounds, earlyStopParam);
+    else if (solverEngine==ENGINE_SA && numNodes>=SAMINNODES && !exact)
+        solution = sa_tsp(me, numInstances, numThreads, inst, maxIt, earlyStopRounds, earlyStopParam);
+    else
+        solution = genetic_tsp(me, numInstances, numThreads, inst->cost_matrix, numNodes, population, top, maxIt, mutatProb, earlyStopRounds, earlyStopParam);
+
+    if (saveTourFile!=NULL && me==0 && !saveTour(saveTourFile, solution, numNodes))
+        cerr << "Cannot write " << saveTourFile << endl;
+    return solution;
+}
+
+#endif
@@ -5,6 +5,19 @@ Purpose: Sorting utilities method for genetic_utils.h
 @author Danilo Franco
 */
 
+#ifndef SORTING_UTILS_H
+#define SORTING_UTILS_H
+
+#include <algorithm>    // lower_bound, upper_bound, max
+
+#include "parallel_backend.h"
+
+#define SORTCUTOFF 32       // ranges up to this length are left to insertionSort
+#define MERGECUTOFF 256     // ranges up to this length are sorted and merged without spawning tasks
+#define MERGETASKS 4        // sorting tasks per core
+
+void insertionSort(int *generation_rank, int *generation_cost, int high);
+
 /////////////////////// MERGE SORT ///////////////////////
 /**
 Performs the merge phase (having two ordered partial, scan them sequentially and insert the minimum found 
@@ -56,7 +69,7 @@ void merge (int* generation_cost, int* generation_rank, int *temp, int low, int
 }
 
 /**
-Perfoms the merge phase of the recursive mergesort algorithm
+Perfoms the merge phase of the recursive mergesort algorithm (ranges up to SORTCUTOFF elements are left to insertionSort)
 
 @param  generation_cost: Sorting array
 @param  generation_rank: Index array
@@ -66,7 +79,10 @@ Perfoms the merge phase of the recursive mergesort algorithm
 @param  high: Ending sorting index [included]
 */
 void mergesort_help(int* generation_cost, int* generation_rank, int *temp, int low, int high){
-    if (low < high) {                
+    if (high-low < SORTCUTOFF) {
+        insertionSort(generation_rank+low, generation_cost+low, high-low);
+    }
+    else {
         int mid = (low + high)/2;
         mergesort_help(generation_cost, generation_rank, temp, low, mid);
         mergesort_help(generation_cost, generation_rank, temp, mid+1, high);
@@ -75,81 +91,162 @@ void mergesort_help(int* generation_cost, int* generation_rank, int *temp, int l
 }
 
 /**
-External method of the recursive mergesort algorithm, deals with starting all the parallel phases
+Sequentially merges two ordered ranges into the auxiliary array starting from a given position (no copy back)
 
 @param  generation_cost: Sorting array
 @param  generation_rank: Index array
-@param  low: Starting sorting index [included]
-@param  high: Ending sorting index [included]
-@param  cores: Number of parallel processing units
+@param  temp: Auxiliary array (cost and index interleaved)
+@param  lowA: First range starting index [included]
+@param  highA: First range ending index [included]
+@param  lowB: Second range starting index [included]
+@param  highB: Second range ending index [included]
+@param  dest: Position in temp of the first merged element
 */
-void mergesort (int* generation_cost, int* generation_rank, int low, int high, int cores) {
-    int numElems,q,fixRemainder,rem,start,end,k,*temp;
+void merge_into(int* generation_cost, int* generation_rank, int *temp, int lowA, int highA, int lowB, int highB, int dest){
+    int i,j,k;
+    i=lowA;
+    j=lowB;
+    k=dest;
 
-    numElems = high+1-low;
-    temp = new int[numElems*2];
-    q = numElems/cores;   // floor quotient
-    fixRemainder = numElems%cores; // remainder
-
-    ///////////////////////   SORT   ///////////////////////
-    start = low;
-    rem = fixRemainder;
-
-    for (k=0; k<cores; ++k){
-        if (rem){
-            end = start+q;
-            rem--;
+    while (i<=highA && j<=highB) {
+        if (generation_cost[i] <= generation_cost[j]){
+            temp[k*2] = generation_cost[i];
+            temp[k*2+1] = generation_rank[i++];
         }
-        else
-            end = start+q-1;
+        else{
+            temp[k*2] = generation_cost[j];
+            temp[k*2+1] = generation_rank[j++];
+        }
+        k++;
+    }
+    while (i<=highA){
+        temp[k*2] = generation_cost[i];
+        temp[k*2+1] = generation_rank[i++];
+        k++;
+    }
+    while (j<=highB){
+        temp[k*2] = generation_cost[j];
+        temp[k*2+1] = generation_rank[j++];
+        k++;
+    }
+}
 
-        #pragma omp task
-        mergesort_help(generation_cost, generation_rank, temp, start, end);
-        start = end+1;
+/**
+Parallel merge of two ordered ranges into the auxiliary array: the middle element of the longer range is placed
+    directly in its final position, found by binary search in the other range, and the two halves left on each of
+    its sides are merged as independent tasks (same stability as merge: equal costs of the first range come first)
+
+@param  generation_cost: Sorting array
+@param  generation_rank: Index array
+@param  temp: Auxiliary array (cost and index interleaved)
+@param  lowA: First range starting index [included]
+@param  highA: First range ending index [included]
+@param  lowB: Second range starting index [included]
+@param  highB: Second range ending index [included]
+@param  dest: Position in temp of the first merged element
+@param  grain: Merges up to this number of elements are performed sequentially
+*/
+void parallel_merge(int* generation_cost, int* generation_rank, int *temp, int lowA, int highA, int lowB, int highB, int dest, int grain){
+    int lenA,lenB,splitA,splitB,pos;
+    lenA = highA-lowA+1;
+    lenB = highB-lowB+1;
+
+    if (lenA+lenB <= grain){
+        merge_into(generation_cost, generation_rank, temp, lowA, highA, lowB, highB, dest);
+        return;
     }
-    #pragma omp taskwait
-    
-    ///////////////////////   MERGE   ///////////////////////
-    int flag,hh,ll,kk,*idx;
-
-    rem = fixRemainder;
-    k = cores;
-    flag = 0;
-    hh = low-1;
-    idx = new int[cores+1]; 
-    idx[0]=low;
-
-    for (kk=0; kk<cores;){
-        ll=hh+1;
-        if(rem){
-            hh=ll+q;
-            rem--;
-        }
-        else
-            hh=ll+q-1;
 
-        idx[++kk]=hh;
+    if (lenA >= lenB){
+        // middle of A: the elements of B strictly lower go before it
+        splitA = lowA+lenA/2;
+        splitB = lower_bound(generation_cost+lowB, generation_cost+highB+1, generation_cost[splitA])-generation_cost;
+        pos = dest+(splitA-lowA)+(splitB-lowB);
+        temp[pos*2] = generation_cost[splitA];
+        temp[pos*2+1] = generation_rank[splitA];
+        parallel_tasks(2, [&](int t){
+            if (t==0)
+                parallel_merge(generation_cost, generation_rank, temp, lowA, splitA-1, lowB, splitB-1, dest, grain);
+            else
+                parallel_merge(generation_cost, generation_rank, temp, splitA+1, highA, splitB, highB, pos+1, grain);
+        });
+    }
+    else {
+        // middle of B: the elements of A lower or equal go before it
+        splitB = lowB+lenB/2;
+        splitA = upper_bound(generation_cost+lowA, generation_cost+highA+1, generation_cost[splitB])-generation_cost;
+        pos = dest+(splitA-lowA)+(splitB-lowB);
+        temp[pos*2] = generation_cost[splitB];
+        temp[pos*2+1] = generation_rank[splitB];
+        parallel_tasks(2, [&](int t){
+            if (t==0)
+                parallel_merge(generation_cost, generation_rank, temp, lowA, splitA-1, lowB, splitB-1, dest, grain);
+            else
+                parallel_merge(generation_cost, generation_rank, temp, splitA, highA, splitB+1, highB, pos+1, grain);
+        });
+    }
+}
+
+/**
+Task-based recursive mergesort: the two halves are sorted as independent tasks down to grain elements
+    (then sequentially with mergesort_help) and merged with parallel_merge, so that every level keeps all the threads busy
+
+@param  generation_cost: Sorting array
+@param  generation_rank: Index array
+@param  temp: Auxiliary array of the mergesort algorithm (cost and index interleaved)
+@param  low: Starting sorting index [included]
+@param  high: Ending sorting index [included]
+@param  grain: Ranges up to this number of elements are sorted (and merged) sequentially
+*/
+void mergesort_task(int* generation_cost, int* generation_rank, int *temp, int low, int high, int grain){
+    if (high-low+1 <= grain){
+        mergesort_help(generation_cost, generation_rank, temp, low, high);
+        return;
     }
 
-    while (k != 1) {
-        for(kk=0; kk<k-1; kk+=2) {
-            #pragma omp task shared(idx)
-            {
-                merge(generation_cost, generation_rank, temp, idx[kk]+(kk!=0), idx[kk+1], idx[kk+2]);
-            }  
+    int mid = (low + high)/2;
+    parallel_tasks(2, [&](int t){
+        if (t==0)
+            mergesort_task(generation_cost, generation_rank, temp, low, mid, grain);
+        else
+            mergesort_task(generation_cost, generation_rank, temp, mid+1, high, grain);
+    });
+
+    parallel_merge(generation_cost, generation_rank, temp, low, mid, mid+1, high, low, grain);
+
+    // copy back from the auxiliary array, split in the same number of tasks as the merge
+    int numChunks = (high-low)/grain+1;
+    parallel_tasks(numChunks, [&](int t){
+        int from = low+(long)(high-low+1)*t/numChunks;
+        int to = low+(long)(high-low+1)*(t+1)/numChunks;
+        for (int i=from; i<to; ++i){
+            generation_cost[i] = temp[i*2];
+            generation_rank[i] = temp[i*2+1];
         }
-        #pragma omp taskwait
+    });
+}
 
-        for(kk=0; kk<k; kk+=2)
-            idx[kk/2+1]= idx[kk+2];
+/**
+External method of the recursive mergesort algorithm, deals with starting all the parallel phases
+    (must be called inside parallel_region)
 
-        flag = k&1; // remainder
-        k = k>>1;
-        k += flag;
-        if (flag) idx[k]=idx[2*k-1]; 
-    }
-    
-    delete temp;
+@version 2.0 (task-based recursion with parallel merge)
+@param  generation_cost: Sorting array
+@param  generation_rank: Index array
+@param  low: Starting sorting index [included]
+@param  high: Ending sorting index [included]
+@param  cores: Number of parallel processing units
+*/
+void mergesort (int* generation_cost, int* generation_rank, int low, int high, int cores) {
+    int numElems,grain,*temp;
+
+    numElems = high+1-low;
+    temp = new int[(high+1)*2];
+    // about MERGETASKS tasks per core, never below MERGECUTOFF elements each
+    grain = max(MERGECUTOFF, numElems/(cores*MERGETASKS)+1);
+
+    mergesort_task(generation_cost, generation_rank, temp, low, high, grain);
+
+    delete[] temp;
 }
 /////////////////////// END MERGE SORT ///////////////////////
 
@@ -236,4 +333,6 @@ void insertionSort(int *generation_rank, int *generation_cost, int high){
         generation_cost[j+1] = key;
         generation_rank[j+1] = key_idx;
     }
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,180 @@
+/**
+warm_start.h
+Purpose: Warm start of the engines from prior tours (--warm-start): the tours are read once per solve, the genetic
+    algorithm puts them and perturbed variants of them in its first generation, the iterated local search and the
+    parallel tempering start their chains and replicas from them instead of the nearest neighbour tour; the best tour
+    found can be written in the same format (--save-tour) for the next solve
+
+@author Danilo Franco
+*/
+
+#ifndef WARM_START_H
+#define WARM_START_H
+
+#include <vector>
+#include <string>
+#include <algorithm>    // copy
+
+#include "population.h"
+#include "rng_utils.h"
+
+#define WARMSHARE 50        // percentage of the first generation made of prior tours and their variants
+#define WARMKICKS 4         // most random segment reversals applied to a variant
+#define WARMSEGMENT 50      // longest reversed segment
+
+vector<vector<int> > warmTours;         // prior tours (only those of the instance size are used)
+
+/**
+Reads a tour: numNodes node indexes separated by white space (as written by saveTour)
+
+@param  tour_f: Path to the tour file
+@param  numNodes: Number of travelling-nodes in the problem
+@param  tour: Written with the tour
+
+@return     False if the file cannot be read or is not a permutation of the numNodes nodes
+*/
+bool readTour(const char *tour_f, int numNodes, vector<int> &tour){
+    FILE *pFile;
+    vector<char> seen(numNodes, 0);
+    int node;
+
+    pFile = fopen(tour_f, "r");
+    if (pFile == NULL)
+        return false;
+    tour.clear();
+    while ((int)tour.size()<=numNodes && fscanf(pFile, "%d", &node)==1){
+        if (node<0 || node>=numNodes || seen[node]){
+            fclose(pFile);
+            return false;
+        }
+        seen[node] = 1;
+        tour.push_back(node);
+    }
+    fclose(pFile);
+    return (int)tour.size() == numNodes;
+}
+
+/**
+Writes a tour, one node index per line
+
+@param  tour_f: Path to the tour file
+@param  tour: Pointer to the nodes permutation
+@param  numNodes: Number of travelling-nodes in the problem
+
+@return     True iff everything has been written
+*/
+bool saveTour(const char *tour_f, const int *tour, int numNodes){
+    FILE *pFile;
+    bool written = true;
+
+    pFile = fopen(tour_f, "w");
+    if (pFile == NULL)
+        return false;
+    for (int i=0; i<numNodes && written; ++i)
+        written = fprintf(pFile, "%d\n", tour[i]) > 0;
+    return fclose(pFile)==0 && written;
+}
+
+/**
+Reads the prior tours of a comma separated list of files into warmTours; the files that do not hold a tour of the
+    instance are reported and skipped (the solve starts cold if none is left)
+
+@param  files: Comma separated paths
+@param  numNodes: Number of travelling-nodes in the problem
+*/
+void loadWarmTours(const char *files, int numNodes){
+    string list(files), tour_f;
+    vector<int> tour;
+    size_t start, end;
+
+    warmTours.clear();
+    for (start=0; start<=list.size(); start=end+1){
+        end = list.find(',', start);
+        if (end == string::npos)
+            end = list.size();
+        tour_f = list.substr(start, end-start);
+        if (tour_f.empty())
+            continue;
+        if (readTour(tour_f.c_str(), numNodes, tour))
+            warmTours.push_back(tour);
+        else
+            cerr << "Warm start: " << tour_f << " is not a tour of " << numNodes << " nodes, ignored" << endl;
+    }
+}
+
+/**
+Number of prior tours of the given size
+
+@param  numNodes: Number of travelling-nodes in the problem
+*/
+int warmCount(int numNodes){
+    int count = 0;
+    for (const vector<int> &tour : warmTours)
+        count += (int)tour.size()==numNodes;
+    return count;
+}
+
+/**
+Copies the k-th prior tour of the given size (cyclically)
+
+@param  numNodes: Number of travelling-nodes in the problem
+@param  k: Index among the prior tours of that size
+@param  tour: Written with the tour
+
+@return     False if there is no prior tour of that size
+*/
+bool warmTour(int numNodes, int k, int *tour){
+    int count = warmCount(numNodes);
+    if (count == 0)
+        return false;
+    k %= count;
+    for (const vector<int> &prior : warmTours)
+        if ((int)prior.size()==numNodes && k-- == 0){
+            copy(prior.begin(), prior.end(), tour);
+            break;
+        }
+    return true;
+}
+
+/**
+Random segment reversal (2-opt move) of at most WARMSEGMENT nodes, taken cyclically
+
+@param  tour: Pointer to the nodes permutation
+@param  numNodes: Number of travelling-nodes in the problem
+*/
+void warmKick(int *tour, int numNodes){
+    int first,len,i,j,t;
+    first = randomBelow(numNodes);
+    len = 2+randomBelow(max(1, min(WARMSEGMENT, numNodes)-1));
+    for (i=first, j=first+len-1; i<j; ++i, --j){
+        t = tour[i%numNodes];
+        tour[i%numNodes] = tour[j%numNodes];
+        tour[j%numNodes] = t;
+    }
+}
+
+/**
+Replaces the first WARMSHARE percent of a randomly initialised population with the prior tours followed by variants
+    of them (1 to WARMKICKS random segment reversals each); the other rows stay random for diversity
+
+@param  pop: Population whose rows are to be seeded (ranked again from scratch)
+*/
+void warmStartPopulation(Population *pop){
+    int numNodes,seeds,rows,i,k;
+
+    numNodes = pop->numNodes;
+    seeds = warmCount(numNodes);
+    if (seeds == 0)
+        return;
+
+    rows = min(max(seeds, (int)((long long)pop->size*WARMSHARE/100)), pop->size);
+    for (i=0; i<rows; ++i){
+        warmTour(numNodes, i, row(pop, i));
+        if (i >= seeds)
+            for (k=1+randomBelow(WARMKICKS); k>0; --k)
+                warmKick(row(pop, i), numNodes);
+    }
+    pop->ranked = 0;
+}
+
+#endif